@@ -24,23 +24,111 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <signal.h>
+#include <spawn.h>
 
 #include "actions.h"
+#include "atoms.h"
+#include "ewmh.h"
 #include "configuration.h"
 
+#ifndef ACTION_MAX_KEY_REPEAT
+#define ACTION_MAX_KEY_REPEAT 100 /* highest '*N' on a key chord */
+#endif
+
 /* Actions */
 const char * action_name[ACTION_COUNT] = {
 		"ERROR", "EXIT_GEST", "EXECUTE", "ICONIFY", "KILL", "RECONF", "RAISE", "LOWER", "MAXIMIZE",
-		"RESTORE", "TOGGLE_MAXIMIZED", "KEYPRESS", "ABORT", "LAST" };
+		"RESTORE", "TOGGLE_MAXIMIZED", "KEYPRESS", "TOGGLE_FULLSCREEN", "TOGGLE_ABOVE", "TOGGLE_STICKY", "MOVE_TO_DESKTOP",
+		"ABORT", "PLUGIN", "LAST" };
 
 const char * get_action_name(int action) {
 	return action_name[action];
 }
 ;
 
-enum {
-	_NET_WM_STATE_REMOVE = 0, _NET_WM_STATE_ADD = 1, _NET_WM_STATE_TOGGLE = 2
-};
+extern char **environ;
+
+/* anything that makes a command need the shell */
+static const char * SHELL_CHARACTERS = "|&;<>()$`\\\"'*?[]#~{}=\n";
+
+/*
+ * Split a command into its arguments, for running it without a shell.
+ * Returns NULL if the command uses any shell syntax.
+ *
+ * PUBLIC
+ */
+char ** action_parse_command(char *command) {
+
+	if (strpbrk(command, SHELL_CHARACTERS)) {
+		return NULL;
+	}
+
+	int capacity = 8;
+	int count = 0;
+	char ** argv = malloc(sizeof(char *) * capacity);
+
+	char * copy = strdup(command);
+	char * saveptr = NULL;
+	char * token = strtok_r(copy, " \t", &saveptr);
+
+	while (token) {
+		if (count + 1 == capacity) {
+			capacity *= 2;
+			argv = realloc(argv, sizeof(char *) * capacity);
+		}
+		argv[count++] = strdup(token);
+		token = strtok_r(NULL, " \t", &saveptr);
+	}
+	argv[count] = NULL;
+
+	free(copy);
+
+	if (count == 0) {
+		free(argv);
+		return NULL;
+	}
+
+	return argv;
+}
+
+/*
+ * Launch a program without waiting for it. argv comes from
+ * action_parse_command; if it is NULL the command is run by /bin/sh.
+ * The children are reaped by the grabber on SIGCHLD. Returns the pid of
+ * the program, or -1 if it could not be launched.
+ *
+ * PUBLIC
+ */
+int action_execute(char **argv, char *command) {
+
+	char * shell_argv[] = { "/bin/sh", "-c", command, NULL };
+
+	if (!argv) {
+		argv = shell_argv;
+	}
+
+	/* signals blocked for the event loop must not stay blocked */
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+
+	sigset_t mask;
+	sigemptyset(&mask);
+	posix_spawnattr_setsigmask(&attr, &mask);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+	pid_t pid;
+	int err = posix_spawnp(&pid, argv[0], NULL, &attr, argv, environ);
+
+	posix_spawnattr_destroy(&attr);
+
+	if (err != 0) {
+		fprintf(stderr, "Error executing '%s': %s\n", command, strerror(err));
+		return -1;
+	}
+
+	return pid;
+}
 
 /*
  * Iconify the focused window at given display.
@@ -91,41 +179,24 @@ void action_lower(Display *dpy, Window w) {
 	return;
 }
 
-/*
- * Taken from wmctrl
+/**
+ * Toggle the maximized state of the focused window at the given Display.
+ *
+ * PUBLIC
  */
-static int client_msg(	Display *disp,
-						Window win,
-						char *msg,
-						unsigned long data0,
-						unsigned long data1,
-						unsigned long data2,
-						unsigned long data3,
-						unsigned long data4) {
-	XEvent event;
-	long mask = SubstructureRedirectMask | SubstructureNotifyMask;
-
-	event.xclient.type = ClientMessage;
-	event.xclient.serial = 0;
-	event.xclient.send_event = True;
-	event.xclient.message_type = XInternAtom(disp, msg, False);
-	event.xclient.window = win;
-	event.xclient.format = 32;
-	event.xclient.data.l[0] = data0;
-	event.xclient.data.l[1] = data1;
-	event.xclient.data.l[2] = data2;
-	event.xclient.data.l[3] = data3;
-	event.xclient.data.l[4] = data4;
-
-	if (XSendEvent(disp, DefaultRootWindow(disp), False, mask, &event)) {
-		return EXIT_SUCCESS;
-	} else {
-		fprintf(stderr, "Cannot send %s event.\n", msg);
-		return EXIT_FAILURE;
-	}
-
-	XFlush(disp);
+void action_toggle_maximized(Display *dpy, Window w) {
+	ewmh_change_state(dpy, w, EWMH_STATE_TOGGLE,
+			ATOM_NET_WM_STATE_MAXIMIZED_VERT, ATOM_NET_WM_STATE_MAXIMIZED_HORZ);
+}
 
+/**
+ * Restore the focused window at the given Display from the maximized state.
+ *
+ * PUBLIC
+ */
+void action_restore(Display *dpy, Window w) {
+	ewmh_change_state(dpy, w, EWMH_STATE_REMOVE,
+			ATOM_NET_WM_STATE_MAXIMIZED_VERT, ATOM_NET_WM_STATE_MAXIMIZED_HORZ);
 }
 
 /**
@@ -133,152 +204,213 @@ static int client_msg(	Display *disp,
  *
  * PUBLIC
  */
-void action_toggle_maximized(Display *dpy, Window w) {
-
-	unsigned long action;
-	Atom prop1 = 0;
-	Atom prop2 = 0;
-
-	action = _NET_WM_STATE_TOGGLE;
-
-	char *tmp_prop2, *tmp2;
-	tmp_prop2 = "_NET_WM_STATE_MAXIMIZED_HORZ";
-	prop2 = XInternAtom(dpy, tmp_prop2, False);
-	char * tmp_prop1 = "_NET_WM_STATE_MAXIMIZED_VERT";
-
-	prop1 = XInternAtom(dpy, tmp_prop1, False);
-
-	client_msg(dpy, w, "_NET_WM_STATE", action, (unsigned long) prop1, (unsigned long) prop2, 0, 0);
+void action_maximize(Display *dpy, Window w) {
+	ewmh_change_state(dpy, w, EWMH_STATE_ADD,
+			ATOM_NET_WM_STATE_MAXIMIZED_VERT, ATOM_NET_WM_STATE_MAXIMIZED_HORZ);
+}
 
+/**
+ * Toggle the fullscreen state of the focused window at the given Display.
+ *
+ * PUBLIC
+ */
+void action_toggle_fullscreen(Display *dpy, Window w) {
+	ewmh_change_state(dpy, w, EWMH_STATE_TOGGLE, ATOM_NET_WM_STATE_FULLSCREEN,
+			-1);
 }
 
 /**
- * Maximize the focused window at the given Display.
+ * Toggle whether the focused window stays above the others.
  *
  * PUBLIC
  */
-void action_restore(Display *dpy, Window w) {
+void action_toggle_above(Display *dpy, Window w) {
+	ewmh_change_state(dpy, w, EWMH_STATE_TOGGLE, ATOM_NET_WM_STATE_ABOVE, -1);
+}
 
-	unsigned long action;
-	Atom prop1 = 0;
-	Atom prop2 = 0;
+/**
+ * Toggle whether the focused window shows on every desktop.
+ *
+ * PUBLIC
+ */
+void action_toggle_sticky(Display *dpy, Window w) {
+	ewmh_change_state(dpy, w, EWMH_STATE_TOGGLE, ATOM_NET_WM_STATE_STICKY, -1);
+}
 
-	action = _NET_WM_STATE_REMOVE;
+/**
+ * Move the focused window to another desktop.
+ *
+ * PUBLIC
+ */
+void action_move_to_desktop(Display *dpy, Window w, int desktop) {
+	ewmh_move_to_desktop(dpy, w, desktop);
+}
 
-	char *tmp_prop2, *tmp2;
-	tmp_prop2 = "_NET_WM_STATE_MAXIMIZED_HORZ";
-	prop2 = XInternAtom(dpy, tmp_prop2, False);
-	char * tmp_prop1 = "_NET_WM_STATE_MAXIMIZED_VERT";
+/* short names for the modifier keys */
+static const char * key_aliases[][2] = {
+		{ "ctrl", "Control_L" },
+		{ "alt", "Alt_L" },
+		{ "shift", "Shift_L" },
+		{ "super", "Super_L" },
+		{ "win", "Super_L" } };
 
-	prop1 = XInternAtom(dpy, tmp_prop1, False);
+static KeySym string_to_keysym(char *name) {
 
-	client_msg(dpy, w, "_NET_WM_STATE", action, (unsigned long) prop1, (unsigned long) prop2, 0, 0);
+	int i;
+	for (i = 0; i < sizeof(key_aliases) / sizeof(key_aliases[0]); i++) {
+		if (strcasecmp(name, key_aliases[i][0]) == 0) {
+			return XStringToKeysym(key_aliases[i][1]);
+		}
+	}
 
+	return XStringToKeysym(name);
 }
 
 /**
- * Maximize the focused window at the given Display.
+ * Parse a key sequence like "Control_L+c, Control_L+v" or "Down*3": a
+ * comma separated list of chords, keys in a chord joined by '+', each
+ * chord optionally followed by '*' and a repeat count. Returns how many
+ * chords there are, or -1 if the sequence is invalid.
  *
  * PUBLIC
  */
-void action_maximize(Display *dpy, Window w) {
+int action_parse_keys(char *str, KeySym **keys, KeyChord **chords) {
 
-	unsigned long action;
-	Atom prop1 = 0;
-	Atom prop2 = 0;
+	char * copy = strdup(str);
+	char * chord_saveptr = NULL;
 
-	action = _NET_WM_STATE_ADD;
+	int key_capacity = 4;
+	int key_count = 0;
+	KeySym * parsed_keys = malloc(sizeof(KeySym) * key_capacity);
 
-	char *tmp_prop2, *tmp2;
-	tmp_prop2 = "_NET_WM_STATE_MAXIMIZED_HORZ";
-	prop2 = XInternAtom(dpy, tmp_prop2, False);
-	char * tmp_prop1 = "_NET_WM_STATE_MAXIMIZED_VERT";
+	int chord_capacity = 2;
+	int chord_count = 0;
+	KeyChord * parsed_chords = malloc(sizeof(KeyChord) * chord_capacity);
 
-	prop1 = XInternAtom(dpy, tmp_prop1, False);
+	char * chord_str = strtok_r(copy, ",", &chord_saveptr);
 
-	client_msg(dpy, w, "_NET_WM_STATE", action, (unsigned long) prop1, (unsigned long) prop2, 0, 0);
+	while (chord_str != NULL) {
 
-}
+		int repeat = 1;
+		char * repeat_str = strchr(chord_str, '*');
 
-/**
- * Fake key event
- */
-void press_key(Display *dpy, KeySym key, Bool is_press) {
+		if (repeat_str) {
+			*repeat_str = '\0';
+			repeat = atoi(repeat_str + 1);
+		}
 
-	XTestFakeKeyEvent(dpy, XKeysymToKeycode(dpy, key), is_press, CurrentTime);
-	return;
-}
+		if (chord_count == chord_capacity) {
+			chord_capacity *= 2;
+			parsed_chords = realloc(parsed_chords,
+					sizeof(KeyChord) * chord_capacity);
+		}
 
-/* alloc a key_press struct ???? */
-struct key_press * alloc_key_press(void) {
-	struct key_press *ans = malloc(sizeof(struct key_press));
-	bzero(ans, sizeof(struct key_press));
-	return ans;
-}
+		KeyChord * chord = &parsed_chords[chord_count++];
+		chord->first_key = key_count;
+		chord->key_count = 0;
+		chord->repeat = repeat;
 
-/**
- * Creates a Keysym from a char sequence
- *
- * PRIVATE
- */
-struct key_press * string_to_keypress(char *str_ptr) {
+		char * key_saveptr = NULL;
+		char * token = strtok_r(chord_str, "+\n\t ", &key_saveptr);
 
-	char * copy = strdup(str_ptr);
+		while (token != NULL) {
 
-	struct key_press base;
-	struct key_press *key;
-	KeySym k;
-	char *str = copy;
-	char *token = str;
-	char *str_dup;
+			KeySym k = string_to_keysym(token);
 
-	if (str == NULL)
-		return NULL;
+			if (k == NoSymbol) {
+				fprintf(stderr, "error converting %s to keysym\n", token);
+				goto error;
+			}
 
-	key = &base;
-	token = strsep(&copy, "+\n ");
-	while (token != NULL) {
-		/* printf("found : %s\n", token); */
-		k = XStringToKeysym(token);
-		if (k == NoSymbol) {
-			fprintf(stderr, "error converting %s to keysym\n", token);
-			exit(-1);
+			if (key_count == key_capacity) {
+				key_capacity *= 2;
+				parsed_keys = realloc(parsed_keys, sizeof(KeySym) * key_capacity);
+			}
+			parsed_keys[key_count++] = k;
+			chord->key_count++;
+
+			token = strtok_r(NULL, "+\n\t ", &key_saveptr);
+		}
+
+		if (chord->key_count == 0 || repeat < 1) {
+			fprintf(stderr, "invalid key chord in '%s'\n", str);
+			goto error;
 		}
-		key->next = alloc_key_press();
-		key = key->next;
-		key->key = k;
-		token = strsep(&copy, "+\n ");
+
+		/* all repeats may be typed in one burst */
+		if (repeat > ACTION_MAX_KEY_REPEAT) {
+			fprintf(stderr, "key chord repeated more than %d times in '%s'\n",
+					ACTION_MAX_KEY_REPEAT, str);
+			goto error;
+		}
+
+		chord_str = strtok_r(NULL, ",", &chord_saveptr);
 	}
 
-	base.next->original_str = str_ptr;
-	return base.next;
+	free(copy);
+
+	*keys = parsed_keys;
+	*chords = parsed_chords;
+	return chord_count;
+
+error:
+	free(parsed_keys);
+	free(parsed_chords);
+	free(copy);
+	return -1;
 }
 
-/**
- * Fake sequence key events
+/*
+ * Press all keys of a chord in order, then release them in reverse order.
  */
-void action_keypress(Display *dpy, char *data) {
-
-	struct key_press * keys = string_to_keypress(data);
+static void press_chord(Keymap *keymap, KeySym *keys, KeyChord *chord) {
 
-	struct key_press *first_key;
-	struct key_press *tmp;
+	Display * dpy = keymap->dpy;
+	KeySym * chord_keys = keys + chord->first_key;
+	KeyCode keycodes[chord->key_count];
 
-	first_key = (struct key_press *) keys;
+	int i;
+	for (i = 0; i < chord->key_count; i++) {
+		keycodes[i] = keymap_get_keycode(keymap, chord_keys[i]);
 
-	if (first_key == NULL) {
-		fprintf(stderr, " internal error in %s, key is null\n", __func__);
-		return;
+		if (!keycodes[i]) {
+			fprintf(stderr, "no key produces %s in the current keymap\n",
+					XKeysymToString(chord_keys[i]));
+		}
 	}
 
-	for (tmp = first_key; tmp != NULL; tmp = tmp->next) {
-		press_key(dpy, tmp->key, True);
+	for (i = 0; i < chord->key_count; i++) {
+		if (keycodes[i])
+			XTestFakeKeyEvent(dpy, keycodes[i], True, CurrentTime);
 	}
 
-	for (tmp = first_key; tmp != NULL; tmp = tmp->next) {
-		press_key(dpy, tmp->key, False);
+	for (i = chord->key_count - 1; i >= 0; i--) {
+		if (keycodes[i])
+			XTestFakeKeyEvent(dpy, keycodes[i], False, CurrentTime);
 	}
+}
 
-	return;
+/**
+ * Type one repetition of a chord.
+ */
+void action_keypress_chord(Keymap *keymap, KeySym *keys, KeyChord *chord) {
+
+	press_chord(keymap, keys, chord);
+	XFlush(keymap->dpy);
+}
+
+/**
+ * Type a whole key sequence at once, in a single request burst. The caller
+ * flushes.
+ */
+void action_keypress(Keymap *keymap, KeySym *keys, KeyChord *chords,
+		int chord_count) {
+
+	int i, r;
+	for (i = 0; i < chord_count; i++) {
+		for (r = 0; r < chords[i].repeat; r++) {
+			press_chord(keymap, keys, &chords[i]);
+		}
+	}
 }
 
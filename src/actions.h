@@ -20,7 +20,10 @@
 
 #include <X11/Xlib.h>
 
-#define ACTION_COUNT 14
+#include "keymap.h"
+#include "configuration.h"
+
+#define ACTION_COUNT 19
 
 /* Actions */
 enum {
@@ -36,16 +39,15 @@ enum {
 	ACTION_RESTORE,
 	ACTION_TOGGLE_MAXIMIZED,
 	ACTION_KEYPRESS,
+	ACTION_TOGGLE_FULLSCREEN,
+	ACTION_TOGGLE_ABOVE,
+	ACTION_TOGGLE_STICKY,
+	ACTION_MOVE_TO_DESKTOP,
 	ACTION_ABORT,
+	ACTION_PLUGIN,
 	ACTION_LAST
 };
 
-struct key_press {
-	KeySym key;
-	struct key_press * next;
-	char *original_str;
-};
-
 const char * get_action_name(int action);
 
 void action_iconify(Display *dpy, Window w);
@@ -55,6 +57,16 @@ void action_lower(Display *dpy, Window w);
 void action_maximize(Display *dpy, Window w);
 void action_restore(Display *dpy, Window w);
 void action_toggle_maximized(Display *dpy, Window w);
-void action_keypress(Display *dpy, char *data);
+void action_toggle_fullscreen(Display *dpy, Window w);
+void action_toggle_above(Display *dpy, Window w);
+void action_toggle_sticky(Display *dpy, Window w);
+void action_move_to_desktop(Display *dpy, Window w, int desktop);
+int action_parse_keys(char *str, KeySym **keys, KeyChord **chords);
+void action_keypress(Keymap *keymap, KeySym *keys, KeyChord *chords,
+		int chord_count);
+void action_keypress_chord(Keymap *keymap, KeySym *keys, KeyChord *chord);
+
+char ** action_parse_command(char *command);
+int action_execute(char **argv, char *command);
 
 #endif
@@ -0,0 +1,46 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "atoms.h"
+
+const char *atom_names[ATOM_COUNT] = {
+	"WM_STATE",
+	"_NET_WM_NAME",
+	"_NET_WM_STATE",
+	"_NET_WM_STATE_MAXIMIZED_HORZ",
+	"_NET_WM_STATE_MAXIMIZED_VERT",
+	"_NET_WM_STATE_FULLSCREEN",
+	"_NET_WM_STATE_ABOVE",
+	"_NET_WM_STATE_STICKY",
+	"_NET_WM_DESKTOP"};
+
+Atom atoms[ATOM_COUNT];
+
+/*
+ * Intern all atoms in a single round trip. Atom values are the same for
+ * every connection to the server, so this is only needed once.
+ */
+void atoms_init(Display *dpy)
+{
+	if (!XInternAtoms(dpy, (char **)atom_names, ATOM_COUNT, False, atoms))
+	{
+		fprintf(stderr, "Error interning atoms.\n");
+		exit(-1);
+	}
+}
@@ -0,0 +1,45 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#ifndef MYGESTURES_ATOMS_H_
+#define MYGESTURES_ATOMS_H_
+
+#include <X11/Xlib.h>
+
+/* Atoms used at runtime. Keep in sync with atom_names in atoms.c */
+enum
+{
+	ATOM_WM_STATE,
+	ATOM_NET_WM_NAME,
+	ATOM_NET_WM_STATE,
+	ATOM_NET_WM_STATE_MAXIMIZED_HORZ,
+	ATOM_NET_WM_STATE_MAXIMIZED_VERT,
+	ATOM_NET_WM_STATE_FULLSCREEN,
+	ATOM_NET_WM_STATE_ABOVE,
+	ATOM_NET_WM_STATE_STICKY,
+	ATOM_NET_WM_DESKTOP,
+	ATOM_COUNT
+};
+
+/* names of the atoms */
+extern const char *atom_names[];
+
+/* interned values, valid after atoms_init */
+extern Atom atoms[];
+
+void atoms_init(Display *dpy);
+
+#endif /* MYGESTURES_ATOMS_H_ */
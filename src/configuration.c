@@ -26,6 +26,14 @@
 #include <assert.h>
 
 #include "configuration.h"
+#include "movement-prefix.h"
+
+#ifndef CONTINUOUS_CHECK_STROKES
+#define CONTINUOUS_CHECK_STROKES 4 /* longest sequence tried against continuous movements at load */
+#endif
+
+/* the symbols of the 8 directions, which include the 4 */
+static const char * ALL_DIRECTIONS = "UDLR1379";
 
 void context_set_title(Context* context, char* window_title) {
 
@@ -102,11 +110,22 @@ void movement_set_expression(Movement* movement, char* movement_expression) {
 		fprintf(stderr, "Warning: Invalid movement sequence: %s\n", regex_str);
 		free(movement_compiled);
 		movement_compiled = NULL;
-	} else {
-		regcomp(movement_compiled, regex_str, REG_EXTENDED | REG_NOSUB);
 	}
 	free(regex_str);
 	movement->expression_compiled = movement_compiled;
+
+	/* NULL if the expression uses something movement-prefix.c does not know */
+	regex_t* prefix_compiled = NULL;
+	char* prefix_str = movement_prefix_expression(movement_expression);
+	if (prefix_str) {
+		prefix_compiled = malloc(sizeof(regex_t));
+		if (regcomp(prefix_compiled, prefix_str, REG_EXTENDED | REG_NOSUB) != 0) {
+			free(prefix_compiled);
+			prefix_compiled = NULL;
+		}
+		free(prefix_str);
+	}
+	movement->prefix_compiled = prefix_compiled;
 }
 
 /* alloc a movement struct */
@@ -173,20 +192,25 @@ Action *configuration_create_action(Gesture * self, int action_type,
 
 	ans->type = action_type;
 	ans->original_str = action_data;
+	ans->gesture = self;
 
 	self->action_list[self->action_count++] = ans;
 
 	return ans;
 }
 
-Gesture * match_gesture(Configuration * self, char * captured_sequence,
-		ActiveWindowInfo * window) {
+/*
+ * Fill context_list with the contexts that apply to the window and return
+ * how many there are. context_list must hold context_count elements.
+ */
+int configuration_match_contexts(Configuration * self,
+		ActiveWindowInfo * window, Context ** context_list) {
 
 	assert(self);
-	assert(captured_sequence);
 	assert(window);
+	assert(context_list);
 
-	Gesture * matched_gesture = NULL;
+	int count = 0;
 
 	int c = 0;
 
@@ -207,6 +231,27 @@ Gesture * match_gesture(Configuration * self, char * captured_sequence,
 			continue;
 		}
 
+		context_list[count++] = context;
+
+	}
+
+	return count;
+}
+
+Gesture * match_gesture(Configuration * self, char * captured_sequence,
+		Context ** context_list, int context_count) {
+
+	assert(self);
+	assert(captured_sequence);
+
+	Gesture * matched_gesture = NULL;
+
+	int c = 0;
+
+	for (c = 0; c < context_count; ++c) {
+
+		Context * context = context_list[c];
+
 		assert(context->gesture_count);
 
 		int g = 0;
@@ -241,21 +286,330 @@ Gesture * configuration_process_gesture(Configuration * self, Capture * grab) {
 
 	Gesture *gest = NULL;
 
+	Context ** context_list = grab->context_list;
+	int context_count = grab->context_count;
+
+	/* contexts were not matched in advance */
+	if (!context_list) {
+		context_list = malloc(sizeof(Context *) * self->context_count);
+		context_count = configuration_match_contexts(self,
+				grab->active_window_info, context_list);
+	}
+
 	int i = 0;
 
 	for (i = 0; i < grab->expression_count; ++i) {
 
 		char * sequence = grab->expression_list[i];
-		gest = match_gesture(self, sequence, grab->active_window_info);
+		gest = match_gesture(self, sequence, context_list, context_count);
 
 		if (gest) {
-			return gest;
+			break;
+		}
+
+	}
+
+	if (context_list != grab->context_list) {
+		free(context_list);
+	}
+
+	return gest;
+
+}
+
+/*
+ * Find the continuous gesture whose movement matches the sequence drawn so
+ * far, in the given contexts.
+ */
+Gesture * configuration_match_continuous(Configuration * self,
+		char * sequence, Context ** context_list, int context_count) {
+
+	assert(self);
+	assert(sequence);
+
+	int c = 0;
+
+	for (c = 0; c < context_count; ++c) {
+
+		Context * context = context_list[c];
+
+		int g = 0;
+
+		for (g = 0; g < context->gesture_count; ++g) {
+
+			Gesture * gest = context->gesture_list[g];
+
+			if (!gest->continuous || !gest->movement
+					|| !gest->movement->expression_compiled) {
+				continue;
+			}
+
+			if (regexec(gest->movement->expression_compiled, sequence, 0,
+					(regmatch_t *) NULL, 0) == 0) {
+				return gest;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Whether the movement could still be drawn by adding one of the direction
+ * symbols to the sequence, and maybe more strokes after it.
+ */
+static int movement_can_extend(Movement * movement, char * sequence,
+		const char * directions) {
+
+	if (!movement || !movement->expression_compiled) {
+		return 0;
+	}
+
+	/* cannot tell: assume it can, so a continuous gesture waits */
+	if (!movement->prefix_compiled) {
+		return 1;
+	}
+
+	int length = strlen(sequence);
+	char extended[length + 2];
+	strcpy(extended, sequence);
+
+	const char * d;
+	for (d = directions; *d; ++d) {
+
+		/* consecutive strokes never share a direction */
+		if (length && *d == sequence[length - 1]) {
+			continue;
+		}
+
+		extended[length] = *d;
+		extended[length + 1] = '\0';
+
+		if (regexec(movement->prefix_compiled, extended, 0,
+				(regmatch_t *) NULL, 0) == 0) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Whether another gesture could still be drawn from the sequence, in which
+ * case a continuous gesture matching it must wait.
+ */
+int configuration_can_extend(Configuration * self, char * sequence,
+		Context ** context_list, int context_count, const char * directions) {
+
+	assert(self);
+	assert(sequence);
+
+	int c = 0;
+
+	for (c = 0; c < context_count; ++c) {
+
+		Context * context = context_list[c];
+
+		int g = 0;
+
+		for (g = 0; g < context->gesture_count; ++g) {
+
+			Gesture * gest = context->gesture_list[g];
+
+			if (!gest->continuous
+					&& movement_can_extend(gest->movement, sequence,
+							directions)) {
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Collect the sequences of up to CONTINUOUS_CHECK_STROKES strokes that the
+ * movement matches.
+ */
+static int collect_matches(Movement * movement, char * sequence, int length,
+		char matches[][CONTINUOUS_CHECK_STROKES + 1], int count, int capacity) {
+
+	if (length && count < capacity
+			&& regexec(movement->expression_compiled, sequence, 0,
+					(regmatch_t *) NULL, 0) == 0) {
+		strcpy(matches[count++], sequence);
+	}
+
+	if (length == CONTINUOUS_CHECK_STROKES) {
+		return count;
+	}
+
+	const char * d;
+	for (d = ALL_DIRECTIONS; *d; ++d) {
+
+		if (length && *d == sequence[length - 1]) {
+			continue;
+		}
+
+		sequence[length] = *d;
+		sequence[length + 1] = '\0';
+		count = collect_matches(movement, sequence, length + 1, matches, count,
+				capacity);
+	}
+
+	sequence[length] = '\0';
+	return count;
+}
+
+/*
+ * Warn about the gestures that start like a continuous gesture of the same
+ * context. The continuous gesture does not repeat while one of them could
+ * still be drawn.
+ */
+void configuration_check_continuous(Configuration * self) {
+
+	assert(self);
+
+	char sequence[CONTINUOUS_CHECK_STROKES + 1];
+	char matches[16][CONTINUOUS_CHECK_STROKES + 1];
+
+	int i = 0;
+
+	for (i = 0; i < self->movement_count; ++i) {
+		Movement * movement = self->movement_list[i];
+
+		if (movement->expression_compiled && !movement->prefix_compiled) {
+			fprintf(stderr,
+					"Warning: cannot tell how movement '%s' starts, continuous gestures will not repeat while it might be drawn: %s\n",
+					movement->name, (char *) movement->expression);
+		}
+	}
+
+	int c = 0;
+
+	for (c = 0; c < self->context_count; ++c) {
+
+		Context * context = self->context_list[c];
+
+		int g = 0;
+
+		for (g = 0; g < context->gesture_count; ++g) {
+
+			Gesture * continuous = context->gesture_list[g];
+
+			if (!continuous->continuous || !continuous->movement
+					|| !continuous->movement->expression_compiled) {
+				continue;
+			}
+
+			sequence[0] = '\0';
+			int count = collect_matches(continuous->movement, sequence, 0,
+					matches, 0, sizeof(matches) / sizeof(matches[0]));
+
+			int o = 0;
+
+			for (o = 0; o < context->gesture_count; ++o) {
+
+				Gesture * other = context->gesture_list[o];
+
+				if (other->continuous) {
+					continue;
+				}
+
+				int m = 0;
+
+				for (m = 0; m < count; ++m) {
+
+					if (movement_can_extend(other->movement, matches[m],
+							ALL_DIRECTIONS)) {
+						fprintf(stderr,
+								"Warning: gesture '%s' starts like continuous gesture '%s', "
+								"which will not repeat after '%s' while '%s' can still be drawn.\n",
+								other->name, continuous->name, matches[m],
+								other->name);
+						break;
+					}
+				}
+			}
 		}
+	}
+}
+
+DeviceSettings * configuration_create_device(Configuration * self,
+		char * device_name) {
+
+	assert(self);
+	assert(device_name);
+
+	DeviceSettings * device = malloc(sizeof(DeviceSettings));
+	bzero(device, sizeof(DeviceSettings));
+
+	device->name = device_name;
+
+	self->device_list[self->device_count++] = device;
 
+	return device;
+}
+
+DeviceSettings * configuration_find_device(Configuration * self,
+		char * device_name) {
+
+	assert(self);
+
+	if (!device_name) {
+		return NULL;
+	}
+
+	int i = 0;
+
+	for (i = 0; i < self->device_count; ++i) {
+		DeviceSettings * device = self->device_list[i];
+
+		if (strcasecmp(device_name, device->name) == 0) {
+			return device;
+		}
 	}
 
 	return NULL;
+}
+
+PluginAction * configuration_create_plugin_action(Configuration * self,
+		char * action_name, MygesturesActionFunction function,
+		void * user_data) {
+
+	assert(self);
+	assert(action_name);
+	assert(function);
 
+	PluginAction * action = malloc(sizeof(PluginAction));
+	bzero(action, sizeof(PluginAction));
+
+	action->name = action_name;
+	action->function = function;
+	action->user_data = user_data;
+
+	self->plugin_action_list[self->plugin_action_count++] = action;
+
+	return action;
+}
+
+PluginAction * configuration_find_plugin_action(Configuration * self,
+		char * action_name) {
+
+	assert(self);
+	assert(action_name);
+
+	int i = 0;
+
+	for (i = 0; i < self->plugin_action_count; ++i) {
+		PluginAction * action = self->plugin_action_list[i];
+
+		if (strcasecmp(action_name, action->name) == 0) {
+			return action;
+		}
+	}
+
+	return NULL;
 }
 
 Movement * configuration_find_movement_by_name(Configuration * self,
@@ -310,6 +664,128 @@ Configuration * configuration_new() {
 	self->context_count = 0;
 	self->context_list = malloc(sizeof(Context *) * 254);
 
+	self->device_count = 0;
+	self->device_list = malloc(sizeof(DeviceSettings *) * 254);
+
+	self->plugin_action_count = 0;
+	self->plugin_action_list = malloc(
+			sizeof(PluginAction *) * MAX_PLUGIN_ACTIONS);
+
+	self->refcount = 1;
+
 	return self;
 
 }
+
+void configuration_ref(Configuration * self) {
+
+	assert(self);
+
+	__atomic_add_fetch(&self->refcount, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Drop a reference. The configuration is freed with the last one, which
+ * may be dropped by an action thread.
+ */
+void configuration_unref(Configuration * self) {
+
+	if (!self) {
+		return;
+	}
+
+	if (__atomic_sub_fetch(&self->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+		configuration_free(self);
+	}
+}
+
+static void regex_free(regex_t * compiled) {
+	if (compiled) {
+		regfree(compiled);
+		free(compiled);
+	}
+}
+
+static void action_free(Action * action) {
+
+	if (action->argv) {
+		char ** arg;
+		for (arg = action->argv; *arg; arg++) {
+			free(*arg);
+		}
+		free(action->argv);
+	}
+
+	free(action->keys);
+	free(action->chords);
+	free(action->original_str);
+	free(action);
+}
+
+static void gesture_free(Gesture * gesture) {
+
+	int a = 0;
+	for (a = 0; a < gesture->action_count; ++a) {
+		action_free(gesture->action_list[a]);
+	}
+
+	free(gesture->action_list);
+	free(gesture->name);
+	free(gesture);
+}
+
+static void context_free(Context * context) {
+
+	int g = 0;
+	for (g = 0; g < context->gesture_count; ++g) {
+		gesture_free(context->gesture_list[g]);
+	}
+
+	free(context->gesture_list);
+	regex_free(context->title_compiled);
+	regex_free(context->class_compiled);
+	free(context->name);
+	free(context->title);
+	free(context->class);
+	free(context);
+}
+
+/*
+ * Free a configuration and everything parsed into it. Use
+ * configuration_unref unless it was never shared.
+ */
+void configuration_free(Configuration * self) {
+
+	assert(self);
+
+	int i = 0;
+
+	for (i = 0; i < self->context_count; ++i) {
+		context_free(self->context_list[i]);
+	}
+	free(self->context_list);
+
+	for (i = 0; i < self->movement_count; ++i) {
+		Movement * movement = self->movement_list[i];
+		regex_free(movement->expression_compiled);
+		regex_free(movement->prefix_compiled);
+		free(movement->expression);
+		free(movement->name);
+		free(movement);
+	}
+	free(self->movement_list);
+
+	for (i = 0; i < self->device_count; ++i) {
+		free(self->device_list[i]->name);
+		free(self->device_list[i]);
+	}
+	free(self->device_list);
+
+	for (i = 0; i < self->plugin_action_count; ++i) {
+		free(self->plugin_action_list[i]->name);
+		free(self->plugin_action_list[i]);
+	}
+	free(self->plugin_action_list);
+
+	free(self);
+}
@@ -19,6 +19,9 @@
 #define MYGESTURES_CONFIGURATION_H_
 
 #include <regex.h>
+#include <X11/X.h>
+
+#include "mygestures-plugin.h"
 
 #define GEST_SEQUENCE_MAX 64
 #define GEST_ACTION_NAME_MAX 32
@@ -33,6 +36,8 @@ typedef struct movement_ {
 	char *name;
 	void *expression;
 	regex_t * expression_compiled;
+	/* matches every prefix of what the expression matches */
+	regex_t * prefix_compiled;
 } Movement;
 
 typedef struct context_ {
@@ -51,6 +56,22 @@ typedef struct context_ {
 
 } Context;
 
+/* per device settings, from <device> elements */
+typedef struct device_settings_ {
+	char *name;
+	/* distance between stroke samples, 0 to derive it from the hardware */
+	int delta_min;
+} DeviceSettings;
+
+#define MAX_PLUGIN_ACTIONS 254
+
+/* an action registered by a plugin */
+typedef struct plugin_action_ {
+	char *name;
+	MygesturesActionFunction function;
+	void *user_data;
+} PluginAction;
+
 typedef struct user_configuration_ {
 
 	Movement** movement_list;
@@ -58,12 +79,45 @@ typedef struct user_configuration_ {
 
 	Context ** context_list;
 	int context_count;
+
+	DeviceSettings ** device_list;
+	int device_count;
+
+	/* from the plugins in <plugin> elements, which stay loaded */
+	PluginAction ** plugin_action_list;
+	int plugin_action_count;
+
+	int continuous_gesture_count;
+
+	/* held by the grabber and by every action queued or running */
+	int refcount;
 } Configuration;
 
+/* keys pressed together, repeat times; the keys are in Action.keys */
+typedef struct key_chord_ {
+	int first_key;
+	int key_count;
+	int repeat;
+} KeyChord;
+
 typedef struct action_ {
 	int type;
 	//struct key_press *data;
 	char *original_str;
+	/* exec: the arguments, or NULL if the command needs the shell */
+	char **argv;
+	/* keypress: the chords to type in order, delay ms apart */
+	KeySym *keys;
+	KeyChord *chords;
+	int chord_count;
+	int delay;
+	/* may run alongside the other actions of the gesture */
+	int parallel;
+	/* move-to-desktop: the desktop, from 0 */
+	int desktop;
+	/* plugin: the registered action */
+	PluginAction *plugin;
+	struct gesture_ *gesture;
 } Action;
 
 typedef struct gesture_ {
@@ -72,6 +126,10 @@ typedef struct gesture_ {
 	Movement *movement;
 	Action ** action_list;
 	int action_count;
+	/* repeats while the movement goes on, every continuous_step pixels,
+	 * or every stroke length when continuous_step is 0 */
+	int continuous;
+	int continuous_step;
 } Gesture;
 
 typedef struct active_window_info_ {
@@ -83,6 +141,9 @@ typedef struct capture_ {
 	int expression_count;
 	char ** expression_list;
 	ActiveWindowInfo * active_window_info;
+	/* contexts matching the window, or NULL to match them on processing */
+	Context ** context_list;
+	int context_count;
 } Capture;
 
 Configuration * configuration_new();
@@ -96,8 +157,25 @@ Movement * configuration_create_movement(	Configuration * self,
 											char *movement_name,
 											char *movement_expression);
 Action * configuration_create_action(Gesture * self, int action_type, char * original_str);
+void configuration_ref(Configuration * self);
+void configuration_unref(Configuration * self);
+void configuration_free(Configuration * self);
+DeviceSettings * configuration_create_device(Configuration * self, char * device_name);
+DeviceSettings * configuration_find_device(Configuration * self, char * device_name);
+PluginAction * configuration_create_plugin_action(Configuration * self,
+		char * action_name, MygesturesActionFunction function,
+		void * user_data);
+PluginAction * configuration_find_plugin_action(Configuration * self,
+		char * action_name);
 Movement * configuration_find_movement_by_name(Configuration * self, char * movement_name);
 int configuration_get_gestures_count(Configuration * self);
+int configuration_match_contexts(Configuration * self,
+		ActiveWindowInfo * window, Context ** context_list);
 Gesture * configuration_process_gesture(Configuration * self, Capture * capture);
+Gesture * configuration_match_continuous(Configuration * self,
+		char * sequence, Context ** context_list, int context_count);
+int configuration_can_extend(Configuration * self, char * sequence,
+		Context ** context_list, int context_count, const char * directions);
+void configuration_check_continuous(Configuration * self);
 
 #endif
@@ -28,9 +28,45 @@
 #include "config.h"
 #include "actions.h"
 #include "configuration_parser.h"
+#include "plugin-loader.h"
 
 const char * CONFIG_FILE_NAME = "mygestures.xml";
 
+/* names of the built-in actions in the configuration file */
+static const struct {
+	const char * name;
+	int id;
+} builtin_actions[] = {
+		{ "iconify", ACTION_ICONIFY },
+		{ "kill", ACTION_KILL },
+		{ "lower", ACTION_LOWER },
+		{ "raise", ACTION_RAISE },
+		{ "maximize", ACTION_MAXIMIZE },
+		{ "restore", ACTION_RESTORE },
+		{ "toggle-maximized", ACTION_TOGGLE_MAXIMIZED },
+		{ "toggle-fullscreen", ACTION_TOGGLE_FULLSCREEN },
+		{ "toggle-above", ACTION_TOGGLE_ABOVE },
+		{ "toggle-sticky", ACTION_TOGGLE_STICKY },
+		{ "move-to-desktop", ACTION_MOVE_TO_DESKTOP },
+		{ "keypress", ACTION_KEYPRESS },
+		{ "reconf", ACTION_RECONF },
+		{ "exec", ACTION_EXECUTE } };
+
+/*
+ * The built-in action with this name, or ACTION_NULL.
+ */
+int configuration_find_builtin_action(char * action_name) {
+
+	int i;
+	for (i = 0; i < sizeof(builtin_actions) / sizeof(builtin_actions[0]); i++) {
+		if (strcasecmp(action_name, builtin_actions[i].name) == 0) {
+			return builtin_actions[i].id;
+		}
+	}
+
+	return ACTION_NULL;
+}
+
 void xml_parse_action(xmlNode *node, Gesture * gest) {
 
 	assert(node);
@@ -40,6 +76,8 @@ void xml_parse_action(xmlNode *node, Gesture * gest) {
 
 	char * action_name = NULL;
 	char * action_value = NULL;
+	int action_delay = 0;
+	int action_parallel = 0;
 
 	xmlAttr* attribute = node->properties;
 
@@ -53,6 +91,11 @@ void xml_parse_action(xmlNode *node, Gesture * gest) {
 			action_name = strdup(value);
 		} else if (strcasecmp(name, "value") == 0) {
 			action_value = strdup(value);
+		} else if (strcasecmp(name, "delay") == 0) {
+			action_delay = atoi(value);
+		} else if (strcasecmp(name, "parallel") == 0) {
+			action_parallel = strcasecmp(value, "true") == 0
+					|| strcasecmp(value, "yes") == 0;
 		}
 
 		xmlFree(value);
@@ -65,38 +108,76 @@ void xml_parse_action(xmlNode *node, Gesture * gest) {
 		return;
 	}
 
-	int id = ACTION_NULL;
-
-	if (strcasecmp(action_name, "iconify") == 0) {
-		id = ACTION_ICONIFY;
-	} else if (strcasecmp(action_name, "kill") == 0) {
-		id = ACTION_KILL;
-	} else if (strcasecmp(action_name, "lower") == 0) {
-		id = ACTION_LOWER;
-	} else if (strcasecmp(action_name, "raise") == 0) {
-		id = ACTION_RAISE;
-	} else if (strcasecmp(action_name, "maximize") == 0) {
-		id = ACTION_MAXIMIZE;
-	} else if (strcasecmp(action_name, "restore") == 0) {
-		id = ACTION_RESTORE;
-	} else if (strcasecmp(action_name, "toggle-maximized") == 0) {
-		id = ACTION_TOGGLE_MAXIMIZED;
-	} else if (strcasecmp(action_name, "keypress") == 0) {
-		id = ACTION_KEYPRESS;
-	} else if (strcasecmp(action_name, "exec") == 0) {
-		id = ACTION_EXECUTE;
-	} else {
-		printf("unknown action '%s' at line %d\n", action_name, node->line);
-		free(action_name);
-		free(action_value);
-		return;
+	int id = configuration_find_builtin_action(action_name);
+	PluginAction * plugin = NULL;
+
+	/* built-in actions come first */
+	if (id == ACTION_NULL) {
+		plugin = configuration_find_plugin_action(
+				gest->context->parent_user_configuration, action_name);
+
+		if (!plugin) {
+			printf("unknown action '%s' at line %d\n", action_name,
+					node->line);
+			free(action_name);
+			free(action_value);
+			return;
+		}
+
+		id = ACTION_PLUGIN;
+	}
+
+	KeySym * keys = NULL;
+	KeyChord * chords = NULL;
+	int chord_count = 0;
+
+	if (id == ACTION_KEYPRESS) {
+		if (action_value) {
+			chord_count = action_parse_keys(action_value, &keys, &chords);
+		}
+		if (chord_count <= 0) {
+			printf("invalid keys for action '%s' at line %d\n", action_name,
+					node->line);
+			free(action_name);
+			free(action_value);
+			return;
+		}
+	}
+
+	int desktop = 0;
+
+	if (id == ACTION_MOVE_TO_DESKTOP) {
+		char * end = NULL;
+		if (action_value) {
+			desktop = strtol(action_value, &end, 10);
+		}
+		if (!action_value || end == action_value || *end || desktop < 0) {
+			printf("invalid desktop for action '%s' at line %d\n",
+					action_name, node->line);
+			free(action_name);
+			free(action_value);
+			return;
+		}
 	}
 
 	if (!action_value) {
-		action_value = "";
+		action_value = strdup("");
 	}
 
-	configuration_create_action(gest, id, action_value);
+	action = configuration_create_action(gest, id, action_value);
+	action->keys = keys;
+	action->chords = chords;
+	action->chord_count = chord_count;
+	action->delay = action_delay > 0 ? action_delay : 0;
+	action->parallel = action_parallel;
+	action->plugin = plugin;
+	action->desktop = desktop;
+
+	if (id == ACTION_EXECUTE) {
+		action->argv = action_parse_command(action_value);
+	}
+
+	free(action_name);
 
 }
 
@@ -107,6 +188,8 @@ static Gesture * xml_parse_gesture(xmlNode *node, Context * context) {
 
 	char * gesture_name = NULL;
 	char * gesture_movement = NULL;
+	int continuous = 0;
+	int continuous_step = 0;
 
 	xmlAttr* attribute = node->properties;
 	while (attribute && attribute->name && attribute->children) {
@@ -119,6 +202,11 @@ static Gesture * xml_parse_gesture(xmlNode *node, Context * context) {
 			gesture_name = strdup(value);
 		} else if (strcasecmp(name, "movement") == 0) {
 			gesture_movement = strdup(value);
+		} else if (strcasecmp(name, "continuous") == 0) {
+			/* "yes", or the distance in pixels between repeats */
+			continuous_step = atoi(value);
+			continuous = continuous_step > 0 || strcasecmp(value, "yes") == 0
+					|| strcasecmp(value, "true") == 0;
 		}
 		xmlFree(value);
 		attribute = attribute->next;
@@ -138,6 +226,13 @@ static Gesture * xml_parse_gesture(xmlNode *node, Context * context) {
 
 	Gesture * gest = configuration_create_gesture(context, gesture_name,
 			gesture_movement);
+	free(gesture_movement);
+
+	if (continuous) {
+		gest->continuous = 1;
+		gest->continuous_step = continuous_step > 0 ? continuous_step : 0;
+		context->parent_user_configuration->continuous_gesture_count++;
+	}
 
 	xmlNode *cur_node = NULL;
 
@@ -195,11 +290,11 @@ static Context * xml_parse_context(xmlNode *node, Configuration * eng) {
 	}
 
 	if (!window_class) {
-		window_class = "";
+		window_class = strdup("");
 	}
 
 	if (!window_title) {
-		window_title = "";
+		window_title = strdup("");
 	}
 
 	Context * ctx = configuration_create_context(eng, context_name,
@@ -274,6 +369,77 @@ void xml_parse_movement(xmlNode *node, Configuration * eng) {
 
 }
 
+void xml_parse_device(xmlNode *node, Configuration * eng) {
+
+	assert(node);
+	assert(eng);
+
+	char * device_name = NULL;
+	int delta_min = 0;
+
+	xmlAttr* attribute = node->properties;
+	while (attribute && attribute->name && attribute->children) {
+
+		char * name = (char *) attribute->name;
+		char * value = (char *) xmlNodeListGetString(node->doc,
+				attribute->children, 1);
+
+		if (strcasecmp(name, "name") == 0) {
+			device_name = strdup(value);
+		} else if (strcasecmp(name, "delta_min") == 0) {
+			delta_min = atoi(value);
+		}
+		xmlFree(value);
+		attribute = attribute->next;
+	}
+
+	if (!device_name) {
+		printf("missing device name at line %d\n", node->line);
+		return;
+	}
+
+	if (delta_min < 0) {
+		printf("invalid delta_min for device '%s' at line %d\n", device_name,
+				node->line);
+		delta_min = 0;
+	}
+
+	DeviceSettings * device = configuration_create_device(eng, device_name);
+	device->delta_min = delta_min;
+
+}
+
+void xml_parse_plugin(xmlNode *node, Configuration * eng) {
+
+	assert(node);
+	assert(eng);
+
+	char * plugin_file = NULL;
+
+	xmlAttr* attribute = node->properties;
+	while (attribute && attribute->name && attribute->children) {
+
+		char * name = (char *) attribute->name;
+		char * value = (char *) xmlNodeListGetString(node->doc,
+				attribute->children, 1);
+
+		if (strcasecmp(name, "file") == 0) {
+			plugin_file = strdup(value);
+		}
+		xmlFree(value);
+		attribute = attribute->next;
+	}
+
+	if (!plugin_file) {
+		printf("missing plugin file at line %d\n", node->line);
+		return;
+	}
+
+	plugin_load(eng, plugin_file);
+	free(plugin_file);
+
+}
+
 void xml_parse_root(xmlNode *node, Configuration * eng) {
 
 	assert(node);
@@ -293,6 +459,14 @@ void xml_parse_root(xmlNode *node, Configuration * eng) {
 
 				xml_parse_movement(cur_node, eng);
 
+			} else if (strcasecmp(element, "device") == 0) {
+
+				xml_parse_device(cur_node, eng);
+
+			} else if (strcasecmp(element, "plugin") == 0) {
+
+				xml_parse_plugin(cur_node, eng);
+
 			} else if (strcasecmp(element, "context") == 0) {
 
 				Context * ctx = xml_parse_context(cur_node, eng);
@@ -326,8 +500,12 @@ static int configuration_parse_file(Configuration * conf, char * filename) {
 	root_element = xmlDocGetRootElement(doc);
 	xml_parse_root(root_element, conf);
 
+	if (conf->continuous_gesture_count) {
+		configuration_check_continuous(conf);
+	}
+
+	/* no xmlCleanupParser: the file may be parsed again on reload */
 	xmlFreeDoc(doc);
-	xmlCleanupParser();
 
 	return 0;
 
@@ -457,7 +635,7 @@ void configuration_load_from_defaults(Configuration * configuration) {
 
 }
 
-void configuration_load_from_file(Configuration * configuration, char * filename) {
+int configuration_load_from_file(Configuration * configuration, char * filename) {
 
 	int err = 0;
 
@@ -465,10 +643,11 @@ void configuration_load_from_file(Configuration * configuration, char * filename
 
 	if (err) {
 		printf("Error loading custom configuration from '%s'\n", filename);
-		return;
+		return err;
 	}
 
 	printf("Loaded %i gestures from \n'%s'.\n",
 			configuration_get_gestures_count(configuration), filename);
 
+	return 0;
 }
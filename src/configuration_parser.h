@@ -21,7 +21,9 @@
 
 char * configuration_get_default_filename();
 
-void configuration_load_from_file(Configuration * configuration, char * filename);
+int configuration_load_from_file(Configuration * configuration, char * filename);
 void configuration_load_from_defaults(Configuration * configuration);
 
+int configuration_find_builtin_action(char * action_name);
+
 #endif
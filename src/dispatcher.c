@@ -0,0 +1,509 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#include <assert.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "dispatcher.h"
+#include "actions.h"
+#include "launcher.h"
+
+#ifndef DISPATCHER_MAX_IN_FLIGHT
+#define DISPATCHER_MAX_IN_FLIGHT 16 /* queued or running actions at once, for all devices */
+#endif
+
+static Configuration *action_get_configuration(Action *action)
+{
+	return action->gesture->context->parent_user_configuration;
+}
+
+static double elapsed_ms(struct timespec *from, struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1000.0 +
+		   (to->tv_nsec - from->tv_nsec) / 1000000.0;
+}
+
+/*
+ * Type the next chord of the delayed keypress action. The timer fires
+ * every action->delay ms until all chords and their repeats are typed.
+ */
+static void worker_on_key_timer(void *data)
+{
+	DispatchWorker *self = data;
+	Action *action = self->key_action;
+
+	if (!action)
+	{
+		reactor_timer_stop(self->key_timer);
+		return;
+	}
+
+	action_keypress_chord(self->keymap, action->keys,
+						  &action->chords[self->key_chord]);
+
+	if (++self->key_repeat == action->chords[self->key_chord].repeat)
+	{
+		self->key_repeat = 0;
+		self->key_chord++;
+	}
+
+	if (self->key_chord == action->chord_count)
+	{
+		self->key_action = NULL;
+		reactor_timer_stop(self->key_timer);
+		configuration_unref(action_get_configuration(action));
+	}
+}
+
+/*
+ * Type whatever is left of the delayed keypress action right away.
+ */
+static void worker_flush_keypress(DispatchWorker *self)
+{
+	while (self->key_action)
+	{
+		worker_on_key_timer(self);
+	}
+}
+
+static void worker_start_keypress(DispatchWorker *self, Action *action)
+{
+	/* a new sequence must not interleave with the previous one */
+	worker_flush_keypress(self);
+
+	if (action->delay <= 0)
+	{
+		action_keypress(self->keymap, action->keys, action->chords,
+						action->chord_count);
+		return;
+	}
+
+	/* the configuration may be reloaded while the keys are typed */
+	configuration_ref(action_get_configuration(action));
+
+	self->key_action = action;
+	self->key_chord = 0;
+	self->key_repeat = 0;
+
+	/* the first chord goes now, the rest on the timer */
+	worker_on_key_timer(self);
+
+	if (self->key_action)
+	{
+		reactor_timer_start(self->key_timer, action->delay, action->delay);
+	}
+}
+
+static void worker_run_plugin(DispatchWorker *self, Action *action,
+							  Window focused_window)
+{
+	Gesture *gesture = action->gesture;
+
+	MygesturesGesture info;
+	info.name = gesture->name;
+	info.movement = gesture->movement ? gesture->movement->name : NULL;
+	info.context = gesture->context->name;
+
+	action->plugin->function(self->dpy, focused_window, &info,
+							 action->original_str, action->plugin->user_data);
+}
+
+/*
+ * Run an action. A launched program is on its own once it is started.
+ */
+static void worker_execute(DispatchWorker *self, Action *action,
+						   Window focused_window)
+{
+	Display *dpy = self->dpy;
+	int launcher_fd;
+
+	assert(action);
+	assert(focused_window);
+
+	switch (action->type)
+	{
+	case ACTION_EXECUTE:
+		pthread_mutex_lock(&self->dispatcher->lock);
+		launcher_fd = self->dispatcher->launcher_fd;
+		pthread_mutex_unlock(&self->dispatcher->lock);
+
+		/* a busy or missing helper must not lose the program */
+		if (launcher_fd < 0 ||
+			launcher_execute(launcher_fd, action->argv,
+							 action->original_str) != 0)
+		{
+			action_execute(action->argv, action->original_str);
+		}
+		break;
+	case ACTION_ICONIFY:
+		action_iconify(dpy, focused_window);
+		break;
+	case ACTION_KILL:
+		action_kill(dpy, focused_window);
+		break;
+	case ACTION_RAISE:
+		action_raise(dpy, focused_window);
+		break;
+	case ACTION_LOWER:
+		action_lower(dpy, focused_window);
+		break;
+	case ACTION_MAXIMIZE:
+		action_maximize(dpy, focused_window);
+		break;
+	case ACTION_RESTORE:
+		action_restore(dpy, focused_window);
+		break;
+	case ACTION_TOGGLE_MAXIMIZED:
+		action_toggle_maximized(dpy, focused_window);
+		break;
+	case ACTION_TOGGLE_FULLSCREEN:
+		action_toggle_fullscreen(dpy, focused_window);
+		break;
+	case ACTION_TOGGLE_ABOVE:
+		action_toggle_above(dpy, focused_window);
+		break;
+	case ACTION_TOGGLE_STICKY:
+		action_toggle_sticky(dpy, focused_window);
+		break;
+	case ACTION_MOVE_TO_DESKTOP:
+		action_move_to_desktop(dpy, focused_window, action->desktop);
+		break;
+	case ACTION_KEYPRESS:
+		worker_start_keypress(self, action);
+		break;
+	case ACTION_PLUGIN:
+		worker_run_plugin(self, action, focused_window);
+		break;
+	default:
+		fprintf(stderr, "found an unknown gesture \n");
+	}
+}
+
+/*
+ * Run the queued jobs. The worker is the only consumer, so the list is
+ * taken whole and the lock is not held while actions run.
+ */
+static void worker_on_wakeup(void *data, int fd, uint32_t events)
+{
+	DispatchWorker *self = data;
+	Dispatcher *dispatcher = self->dispatcher;
+	uint64_t count;
+
+	if (read(fd, &count, sizeof(count)) < 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&dispatcher->lock);
+	DispatchJob *job = self->first;
+	int stopping = self->stopping;
+	self->first = NULL;
+	self->last = NULL;
+	pthread_mutex_unlock(&dispatcher->lock);
+
+	while (job)
+	{
+		struct timespec started, finished;
+		clock_gettime(CLOCK_MONOTONIC, &started);
+
+		worker_execute(self, job->action, job->window);
+
+		clock_gettime(CLOCK_MONOTONIC, &finished);
+		printf("     Action %s done in %.2f ms (waited %.2f ms)\n",
+			   get_action_name(job->action->type),
+			   elapsed_ms(&started, &finished),
+			   elapsed_ms(&job->queued, &started));
+
+		pthread_mutex_lock(&dispatcher->lock);
+		self->pending--;
+		pthread_mutex_unlock(&dispatcher->lock);
+
+		__atomic_sub_fetch(dispatcher->in_flight, 1, __ATOMIC_SEQ_CST);
+
+		configuration_unref(action_get_configuration(job->action));
+
+		DispatchJob *next = job->next;
+		free(job);
+		job = next;
+	}
+
+	/* the actions of a gesture are queued together: one flush for all */
+	XFlush(self->dpy);
+
+	if (stopping)
+	{
+		worker_flush_keypress(self);
+		reactor_stop(self->reactor);
+	}
+}
+
+static void worker_drain_events(DispatchWorker *self)
+{
+	XEvent ev;
+
+	while (XPending(self->dpy))
+	{
+		XNextEvent(self->dpy, &ev);
+
+		if (ev.type == MappingNotify)
+		{
+			keymap_handle_event(self->keymap, &ev);
+		}
+	}
+}
+
+static void worker_on_x_readable(void *data, int fd, uint32_t events)
+{
+	worker_drain_events((DispatchWorker *)data);
+}
+
+static void worker_on_prepare(void *data)
+{
+	worker_drain_events((DispatchWorker *)data);
+}
+
+static void *worker_thread(void *data)
+{
+	DispatchWorker *self = data;
+
+	reactor_run(self->reactor);
+
+	return NULL;
+}
+
+static void worker_init(DispatchWorker *self, Dispatcher *dispatcher)
+{
+	self->dispatcher = dispatcher;
+	self->dpy = XOpenDisplay(NULL);
+
+	if (!self->dpy)
+	{
+		printf("Cannot open a display for the actions.\n");
+		exit(-1);
+	}
+
+	/* launched programs open their own connection */
+	fcntl(ConnectionNumber(self->dpy), F_SETFD, FD_CLOEXEC);
+
+	self->keymap = keymap_new(self->dpy);
+	self->reactor = reactor_new();
+	self->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	reactor_add_fd(self->reactor, self->event_fd, EPOLLIN, worker_on_wakeup,
+				   self);
+	reactor_add_fd(self->reactor, ConnectionNumber(self->dpy), EPOLLIN,
+				   worker_on_x_readable, self);
+	reactor_set_prepare(self->reactor, worker_on_prepare, self);
+	self->key_timer = reactor_add_timer(self->reactor, worker_on_key_timer,
+										self);
+
+	/* signals are taken by the grabber's signalfd, never by a worker */
+	sigset_t all, old;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	pthread_create(&self->thread, NULL, worker_thread, self);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+static void worker_wake(DispatchWorker *self)
+{
+	uint64_t one = 1;
+
+	if (write(self->event_fd, &one, sizeof(one)) < 0)
+	{
+		perror("Waking the action dispatcher");
+	}
+}
+
+/*
+ * Run what is still queued, then stop the worker and release it.
+ */
+static void worker_deinit(DispatchWorker *self)
+{
+	pthread_mutex_lock(&self->dispatcher->lock);
+	self->stopping = 1;
+	pthread_mutex_unlock(&self->dispatcher->lock);
+
+	worker_wake(self);
+	pthread_join(self->thread, NULL);
+
+	reactor_free(self->reactor);
+	close(self->event_fd);
+	keymap_free(self->keymap);
+	XCloseDisplay(self->dpy);
+}
+
+Dispatcher *dispatcher_new()
+{
+	Dispatcher *self = malloc(sizeof(Dispatcher));
+	bzero(self, sizeof(Dispatcher));
+
+	pthread_mutex_init(&self->lock, NULL);
+	self->launcher_fd = -1;
+	self->in_flight = &self->own_in_flight;
+
+	int w;
+	for (w = 0; w < DISPATCHER_WORKERS; w++)
+	{
+		worker_init(&self->workers[w], self);
+	}
+
+	return self;
+}
+
+/*
+ * Queue an action, with the lock held. Returns the worker it went to, or
+ * NULL if too many actions are in flight.
+ */
+static DispatchWorker *dispatcher_queue(Dispatcher *self, Action *action,
+										Window window)
+{
+	/* other grabber processes may be counting too */
+	if (__atomic_add_fetch(self->in_flight, 1, __ATOMIC_SEQ_CST) >
+		DISPATCHER_MAX_IN_FLIGHT)
+	{
+		__atomic_sub_fetch(self->in_flight, 1, __ATOMIC_SEQ_CST);
+		return NULL;
+	}
+
+	DispatchWorker *worker = &self->workers[0];
+
+	if (action->parallel)
+	{
+		worker = &self->workers[1];
+
+		int w;
+		for (w = 2; w < DISPATCHER_WORKERS; w++)
+		{
+			if (self->workers[w].pending < worker->pending)
+				worker = &self->workers[w];
+		}
+	}
+
+	/* the action must outlive a configuration reload */
+	configuration_ref(action_get_configuration(action));
+
+	DispatchJob *job = malloc(sizeof(DispatchJob));
+	job->action = action;
+	job->window = window;
+	job->next = NULL;
+	clock_gettime(CLOCK_MONOTONIC, &job->queued);
+
+	if (worker->last)
+		worker->last->next = job;
+	else
+		worker->first = job;
+	worker->last = job;
+	worker->pending++;
+
+	return worker;
+}
+
+/*
+ * Queue the actions of a gesture. Ordered actions keep their order on the
+ * first worker, parallel ones may run alongside them. Each worker gets the
+ * gesture's actions in a single batch. Actions over the in-flight limit
+ * are skipped, so that repeating a gesture cannot pile up work. Returns how
+ * many actions were queued.
+ */
+int dispatcher_push_gesture(Dispatcher *self, Gesture *gesture,
+							 Window window)
+{
+	assert(self);
+	assert(gesture);
+
+	int woken[DISPATCHER_WORKERS] = {0};
+	int queued = 0;
+
+	pthread_mutex_lock(&self->lock);
+
+	int a;
+	for (a = 0; a < gesture->action_count; a++)
+	{
+		Action *action = gesture->action_list[a];
+
+		/* handled by the grabber */
+		if (action->type == ACTION_RECONF)
+			continue;
+
+		DispatchWorker *worker = dispatcher_queue(self, action, window);
+
+		if (!worker)
+		{
+			printf("     Too many actions in flight, skipping %s %s\n",
+				   get_action_name(action->type), action->original_str);
+			continue;
+		}
+
+		woken[worker - self->workers] = 1;
+		queued++;
+	}
+
+	pthread_mutex_unlock(&self->lock);
+
+	int w;
+	for (w = 0; w < DISPATCHER_WORKERS; w++)
+	{
+		if (woken[w])
+			worker_wake(&self->workers[w]);
+	}
+
+	return queued;
+}
+
+/*
+ * Count actions in flight in a counter shared with the dispatchers of the
+ * other devices. Must be called before anything is pushed.
+ */
+void dispatcher_set_in_flight_counter(Dispatcher *self, int *counter)
+{
+	self->in_flight = counter;
+}
+
+/*
+ * May be called while the workers run, when the helper goes away.
+ */
+void dispatcher_set_launcher(Dispatcher *self, int launcher_fd)
+{
+	pthread_mutex_lock(&self->lock);
+	self->launcher_fd = launcher_fd;
+	pthread_mutex_unlock(&self->lock);
+}
+
+void dispatcher_free(Dispatcher *self)
+{
+	if (!self)
+		return;
+
+	int w;
+	for (w = 0; w < DISPATCHER_WORKERS; w++)
+	{
+		worker_deinit(&self->workers[w]);
+	}
+
+	pthread_mutex_destroy(&self->lock);
+	free(self);
+}
@@ -0,0 +1,105 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#ifndef MYGESTURES_DISPATCHER_H_
+#define MYGESTURES_DISPATCHER_H_
+
+#include <pthread.h>
+#include <time.h>
+#include <X11/Xlib.h>
+
+#include "configuration.h"
+#include "keymap.h"
+#include "reactor.h"
+
+/* one worker runs ordered actions, the others parallel ones */
+#define DISPATCHER_WORKERS 3
+
+typedef struct dispatch_job_
+{
+	Action *action;
+	Window window;
+	struct timespec queued;
+
+	struct dispatch_job_ *next;
+
+} DispatchJob;
+
+struct dispatcher_;
+
+/*
+ * A thread with its own X connection and reactor. Jobs are handed over
+ * through a list protected by the dispatcher lock and an eventfd watched by
+ * the worker's reactor.
+ */
+typedef struct dispatch_worker_
+{
+	struct dispatcher_ *dispatcher;
+
+	Display *dpy;
+	Keymap *keymap;
+	Reactor *reactor;
+
+	pthread_t thread;
+	int event_fd;
+
+	/* protected by the dispatcher lock */
+	DispatchJob *first;
+	DispatchJob *last;
+	int pending;
+	int stopping;
+
+	/* keypress action being typed with a delay between chords */
+	ReactorTimer *key_timer;
+	Action *key_action;
+	int key_chord;
+	int key_repeat;
+
+} DispatchWorker;
+
+/*
+ * Runs matched actions on worker threads, so the grabber can restore its
+ * grab and go on capturing while a window is killed or keys are typed.
+ * Ordered actions all go to the first worker and run one after another;
+ * parallel ones go to whichever other worker has the least to do.
+ */
+typedef struct dispatcher_
+{
+	DispatchWorker workers[DISPATCHER_WORKERS];
+
+	pthread_mutex_t lock;
+
+	/* queued or running actions, changed atomically; points to
+	 * own_in_flight or to a counter shared by all grabber processes */
+	int *in_flight;
+	int own_in_flight;
+
+	/* channel to the launcher helper, or -1 to launch programs directly,
+	 * protected by the lock */
+	int launcher_fd;
+
+} Dispatcher;
+
+Dispatcher *dispatcher_new();
+void dispatcher_free(Dispatcher *self);
+
+int dispatcher_push_gesture(Dispatcher *self, Gesture *gesture,
+							Window window);
+void dispatcher_set_launcher(Dispatcher *self, int launcher_fd);
+void dispatcher_set_in_flight_counter(Dispatcher *self, int *counter);
+
+#endif /* MYGESTURES_DISPATCHER_H_ */
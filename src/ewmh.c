@@ -0,0 +1,83 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#include <stdio.h>
+
+#include "ewmh.h"
+#include "atoms.h"
+
+/* the request comes from a pager or similar tool acting for the user */
+#define EWMH_SOURCE_PAGER 2
+
+/*
+ * Send a client message about w to the window manager. message is an
+ * index into the atom table. Returns 0 if it was queued.
+ */
+int ewmh_client_message(Display *dpy, Window w, int message,
+						long data0, long data1, long data2, long data3,
+						long data4)
+{
+	XEvent event;
+	long mask = SubstructureRedirectMask | SubstructureNotifyMask;
+
+	event.xclient.type = ClientMessage;
+	event.xclient.serial = 0;
+	event.xclient.send_event = True;
+	event.xclient.message_type = atoms[message];
+	event.xclient.window = w;
+	event.xclient.format = 32;
+	event.xclient.data.l[0] = data0;
+	event.xclient.data.l[1] = data1;
+	event.xclient.data.l[2] = data2;
+	event.xclient.data.l[3] = data3;
+	event.xclient.data.l[4] = data4;
+
+	if (!XSendEvent(dpy, DefaultRootWindow(dpy), False, mask, &event))
+	{
+		fprintf(stderr, "Cannot send %s event.\n", atom_names[message]);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Add, remove or toggle one or two _NET_WM_STATE properties, given as atom
+ * indices. second_state is -1 when there is only one.
+ */
+void ewmh_change_state(Display *dpy, Window w, int how, int first_state,
+					   int second_state)
+{
+	if (w == None)
+		return;
+
+	ewmh_client_message(dpy, w, ATOM_NET_WM_STATE, how, atoms[first_state],
+						second_state < 0 ? 0 : atoms[second_state],
+						EWMH_SOURCE_PAGER, 0);
+}
+
+/*
+ * Move w to a desktop, counted from 0. 0xFFFFFFFF shows it on all.
+ */
+void ewmh_move_to_desktop(Display *dpy, Window w, long desktop)
+{
+	if (w == None)
+		return;
+
+	ewmh_client_message(dpy, w, ATOM_NET_WM_DESKTOP, desktop,
+						EWMH_SOURCE_PAGER, 0, 0, 0);
+}
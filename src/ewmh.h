@@ -0,0 +1,45 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#ifndef MYGESTURES_EWMH_H_
+#define MYGESTURES_EWMH_H_
+
+#include <X11/Xlib.h>
+
+/*
+ * Requests to an EWMH window manager. They use the atoms interned by
+ * atoms_init and only queue the client messages: the caller flushes once
+ * after all the actions of a gesture.
+ */
+
+/* how _NET_WM_STATE changes the listed properties */
+enum
+{
+	EWMH_STATE_REMOVE = 0,
+	EWMH_STATE_ADD = 1,
+	EWMH_STATE_TOGGLE = 2
+};
+
+int ewmh_client_message(Display *dpy, Window w, int message,
+						long data0, long data1, long data2, long data3,
+						long data4);
+
+void ewmh_change_state(Display *dpy, Window w, int how, int first_state,
+					   int second_state);
+void ewmh_move_to_desktop(Display *dpy, Window w, long desktop);
+
+#endif /* MYGESTURES_EWMH_H_ */
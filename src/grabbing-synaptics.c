@@ -31,13 +31,34 @@
 #include <math.h>
 
 #include <sys/time.h>
+#include <time.h>
 
 #include "grabbing-synaptics.h"
 
 #define SHM_SYNAPTICS 23947
 
+/* milliseconds between two reads of the shared memory */
+#define SYNAPTICS_POLL_INTERVAL 10
+
 #define SYNAPTICS_PROP_TAP_ACTION "Synaptics Tap Action"
 
+/*
+ * Interned together, only if they already exist: a missing synaptics atom
+ * means there is no synaptics driver.
+ */
+enum
+{
+	SYNAPTICS_ATOM_TOUCHPAD,
+	SYNAPTICS_ATOM_TAP_ACTION,
+	SYNAPTICS_ATOM_COUNT
+};
+
+static char *synaptics_atom_names[SYNAPTICS_ATOM_COUNT] = {
+	XI_TOUCHPAD,
+	SYNAPTICS_PROP_TAP_ACTION};
+
+static Atom synaptics_atoms[SYNAPTICS_ATOM_COUNT];
+
 static XDevice *
 dp_get_device(Display *dpy)
 {
@@ -50,8 +71,8 @@ dp_get_device(Display *dpy)
 	int nprops = 0;
 	int error = 0;
 
-	touchpad_type = XInternAtom(dpy, XI_TOUCHPAD, True);
-	synaptics_property = XInternAtom(dpy, SYNAPTICS_PROP_TAP_ACTION, True);
+	touchpad_type = synaptics_atoms[SYNAPTICS_ATOM_TOUCHPAD];
+	synaptics_property = synaptics_atoms[SYNAPTICS_ATOM_TAP_ACTION];
 	info = XListInputDevices(dpy, &ndevices);
 
 	while (ndevices--)
@@ -187,7 +208,7 @@ void synaptics_disable_3fingers_tap(Grabber *self, XDevice *dev)
 	int format;
 	unsigned long nitems, bytes_after;
 	unsigned char *data = NULL;
-	prop = XInternAtom(self->dpy, SYNAPTICS_PROP_TAP_ACTION, True);
+	prop = synaptics_atoms[SYNAPTICS_ATOM_TAP_ACTION];
 
 	/* get current configuration */
 
@@ -208,6 +229,89 @@ void synaptics_disable_3fingers_tap(Grabber *self, XDevice *dev)
 	}
 }
 
+typedef struct synaptics_state_
+{
+	Grabber *grabber;
+	SynapticsSHM *synshm;
+	SynapticsSHM old;
+	int max_fingers;
+} SynapticsState;
+
+/*
+ * The shared memory has no timestamps. Use the time it was sampled, in
+ * milliseconds like X event times.
+ */
+static Time synaptics_get_time()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void synaptics_on_timer(void *data)
+{
+	SynapticsState *state = data;
+	Grabber *self = state->grabber;
+
+	SynapticsSHM cur = *state->synshm;
+
+	if (!synaptics_shm_is_equal(&state->old, &cur))
+	{
+
+		// release
+		if (cur.numFingers >= 3 && state->max_fingers >= 3)
+		{
+
+			grabbing_update_movement(self, cur.x, cur.y, synaptics_get_time());
+
+			//// got > 3 fingers
+		}
+		else if (cur.numFingers == 0 && state->max_fingers >= 3)
+		{
+
+			if (self->verbose)
+			{
+				syn_print(&cur);
+				printf("stopped	\n");
+			}
+
+			// reset max fingers
+			state->max_fingers = 0;
+
+			grabbing_end_movement(self, state->old.x, state->old.y, "Synaptics",
+								  self->conf);
+		}
+		else if (cur.numFingers >= 3 && state->max_fingers < 3)
+		{
+
+			if (self->verbose)
+			{
+
+				syn_print(&cur);
+			}
+
+			state->max_fingers = state->max_fingers + 1;
+
+			if (state->max_fingers >= 3)
+			{
+
+				if (self->verbose)
+				{
+					printf("started\n");
+				}
+
+				grabbing_start_movement(self, cur.x, cur.y, synaptics_get_time());
+				grabbing_set_target(self, None, None, self->conf);
+			}
+		}
+
+		//// movement
+	}
+
+	state->old = cur;
+}
+
 void grabber_synaptics_loop(Grabber *self, Configuration *conf)
 {
 
@@ -215,7 +319,10 @@ void grabber_synaptics_loop(Grabber *self, Configuration *conf)
 
 	Atom synaptics_property = 0;
 
-	synaptics_property = XInternAtom(self->dpy, SYNAPTICS_PROP_TAP_ACTION, True);
+	XInternAtoms(self->dpy, synaptics_atom_names, SYNAPTICS_ATOM_COUNT, True,
+				 synaptics_atoms);
+
+	synaptics_property = synaptics_atoms[SYNAPTICS_ATOM_TAP_ACTION];
 	if (!synaptics_property)
 	{
 		fprintf(stderr, "Synaptics driver not found. Multitouch gestures disabled. \n");
@@ -246,78 +353,21 @@ void grabber_synaptics_loop(Grabber *self, Configuration *conf)
 		return;
 	}
 
-	int delay = 10;
-
-	SynapticsSHM old;
-
-	memset(&old, 0, sizeof(SynapticsSHM));
-	old.x = -1; /* Force first equality test to fail */
+	SynapticsState *state = malloc(sizeof(SynapticsState));
+	bzero(state, sizeof(SynapticsState));
 
-	int max_fingers = 0;
+	state->grabber = self;
+	state->synshm = synshm;
+	state->old.x = -1; /* Force first equality test to fail */
 
-	while (!self->shut_down)
-	{
+	/* the driver only offers shared memory, so it is sampled on a timer */
+	ReactorTimer *timer = reactor_add_timer(self->reactor,
+											synaptics_on_timer, state);
+	reactor_timer_start(timer, SYNAPTICS_POLL_INTERVAL,
+						SYNAPTICS_POLL_INTERVAL);
 
-		SynapticsSHM cur = *synshm;
+	reactor_run(self->reactor);
 
-		if (!synaptics_shm_is_equal(&old, &cur))
-		{
-
-			int delay = 10;
-
-			// release
-			if (cur.numFingers >= 3 && max_fingers >= 3)
-			{
-
-				grabbing_update_movement(self, cur.x, cur.y);
-
-				//// got > 3 fingers
-			}
-			else if (cur.numFingers == 0 && max_fingers >= 3)
-			{
-
-				if (self->verbose)
-				{
-					syn_print(&cur);
-					printf("stopped	\n");
-				}
-
-				// reset max fingers
-				max_fingers = 0;
-
-				grabbing_end_movement(self, old.x, old.y, "Synaptics", conf);
-
-				/// energy economy
-				int delay = 50;
-			}
-			else if (cur.numFingers >= 3 && max_fingers < 3)
-			{
-
-				if (self->verbose)
-				{
-
-					syn_print(&cur);
-				}
-
-				max_fingers = max_fingers + 1;
-
-				if (max_fingers >= 3)
-				{
-
-					if (self->verbose)
-					{
-						printf("started\n");
-					}
-
-					grabbing_start_movement(self, cur.x, cur.y);
-				}
-			}
-
-			//// movement
-		}
-
-		usleep(delay * 1000);
-
-		old = cur;
-	}
+	reactor_remove(self->reactor, timer);
+	free(state);
 }
@@ -16,34 +16,110 @@
  one line to give the program's name and an idea of what it does.
  */
 
+#define _GNU_SOURCE /* needed by struct ucred */
+
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fcntl.h>
 
 #include <X11/extensions/XTest.h>	/* emulating device events */
 #include <X11/extensions/XInput2.h> /* capturing device events */
+#include <X11/extensions/Xrandr.h>	/* physical size of the monitors */
 
 #include "drawing/drawing-brush-image.h"
 
 #include "grabbing.h"
 #include "grabbing-synaptics.h"
 #include "actions.h"
+#include "atoms.h"
+#include "xi-motion.h"
+#include "launcher.h"
+#include "configuration_parser.h"
+
+#ifndef STROKE_LENGTH_MM
+#define STROKE_LENGTH_MM 8.0 /* about 30 pixels on a 96 dpi screen */
+#endif
+
+#ifndef STROKE_HYSTERESIS_BINS
+#define STROKE_HYSTERESIS_BINS 3 /* quantizer bins (11.25 degrees) added to the current direction */
+#endif
+
+#ifndef STROKE_COMMIT_LENGTH
+#define STROKE_COMMIT_LENGTH 1.5 /* times delta_min to start a new stroke */
+#endif
+
+#ifndef PATH_CAPACITY
+#define PATH_CAPACITY 4096 /* points kept for simplification */
+#endif
+
+#ifndef PATH_SIMPLIFY_TOLERANCE
+#define PATH_SIMPLIFY_TOLERANCE 0.5 /* times delta_min */
+#endif
+
+#ifndef FAST_STROKE_MS
+#define FAST_STROKE_MS 50 /* a stroke faster than delta_min per FAST_STROKE_MS is a flick */
+#endif
+
+#ifndef MOTION_BACKLOG_DEGRADE
+#define MOTION_BACKLOG_DEGRADE 32 /* queued motion events before drawing is skipped */
+#endif
+
+#ifndef CONTINUOUS_INTERVAL_MS
+#define CONTINUOUS_INTERVAL_MS 40 /* at most one repeat of a continuous gesture per interval */
+#endif
+
+#ifndef CONTINUOUS_MAX_OWED
+#define CONTINUOUS_MAX_OWED 3 /* repeats kept waiting when moving faster than that */
+#endif
 
 #ifndef MAX_STROKES_PER_CAPTURE
 #define MAX_STROKES_PER_CAPTURE 63 /*TODO*/
 #endif
 
-const char stroke_representations[] = {' ', 'L', 'R', 'U', 'D', '1', '3', '7',
-									   '9'};
+/*
+ * Windows we look at may be destroyed at any time. Don't let the default
+ * handler exit the grabber because of that.
+ */
+static int grabber_x_error_handler(Display *dpy, XErrorEvent *error)
+{
+	if (error->error_code == BadWindow)
+	{
+		return 0;
+	}
+
+	char text[256];
+	XGetErrorText(dpy, error->error_code, text, sizeof(text));
+	fprintf(stderr, "X error: %s (request %d)\n", text, error->request_code);
+
+	return 0;
+}
 
 static void grabber_open_display(Grabber *self)
 {
 
 	self->dpy = XOpenDisplay(NULL);
 
+	/* launched programs open their own connection */
+	fcntl(ConnectionNumber(self->dpy), F_SETFD, FD_CLOEXEC);
+
+	XSetErrorHandler(grabber_x_error_handler);
+
+	atoms_init(self->dpy);
+
+	self->window_cache = window_cache_new(self->dpy);
+
 	if (!XQueryExtension(self->dpy, "XInputExtension", &(self->opcode),
 						 &(self->event), &(self->error)))
 	{
@@ -51,12 +127,21 @@ static void grabber_open_display(Grabber *self)
 		exit(-1);
 	}
 
-	int major = 2, minor = 0;
+	/* since XI 2.1 raw events are delivered to root selections during grabs */
+	int major = 2, minor = self->raw_motion ? 1 : 0;
 	if (XIQueryVersion(self->dpy, &major, &minor) == BadRequest)
 	{
 		printf("XI2 not available. Server supports %d.%d\n", major, minor);
 		exit(-1);
 	}
+
+	if (self->raw_motion && minor < 1)
+	{
+		printf("XI 2.1 not available, using accelerated motion.\n");
+		self->raw_motion = 0;
+	}
+
+	xi_motion_install(self->dpy, self->opcode);
 }
 
 static struct brush_image_t *get_brush_image(char *color)
@@ -110,118 +195,6 @@ static void grabber_init_drawing(Grabber *self)
 	}
 }
 
-static Status fetch_window_title(Display *dpy, Window w, char **out_window_title)
-{
-    XTextProperty text_prop;
-    char **list = NULL;
-    int num = 0;
-    Atom net_wm_name = XInternAtom(dpy, "_NET_WM_NAME", False);
-
-    /* Try _NET_WM_NAME (UTF8) first */
-    if (XGetTextProperty(dpy, w, &text_prop, net_wm_name) && text_prop.value) {
-        if (Xutf8TextPropertyToTextList(dpy, &text_prop, &list, &num) >= Success && num > 0 && list && *list) {
-            *out_window_title = strdup(*list);
-            XFree(text_prop.value);
-            XFreeStringList(list);
-            return 1;
-        }
-        XFree(text_prop.value);
-    }
-
-    /* Fallback to WM_NAME */
-    if (XGetWMName(dpy, w, &text_prop) && text_prop.value) {
-        if (Xutf8TextPropertyToTextList(dpy, &text_prop, &list, &num) >= Success && num > 0 && list && *list) {
-            *out_window_title = strdup(*list);
-            XFree(text_prop.value);
-            XFreeStringList(list);
-            return 1;
-        }
-        XFree(text_prop.value);
-    }
-
-    /* nothing found */
-    *out_window_title = strdup("");
-    return 1;
-}
-
-/*
- * Return a window_info struct for the focused window at a given Display.
- */
-static ActiveWindowInfo *get_active_window_info(Display *dpy, Window win)
-{
-    int ret, val;
-
-    char *win_title = NULL;
-    ret = fetch_window_title(dpy, win, &win_title);
-
-    ActiveWindowInfo *ans = malloc(sizeof(ActiveWindowInfo));
-    bzero(ans, sizeof(ActiveWindowInfo));
-
-    char *win_class = NULL;
-    XClassHint class_hints;
-
-    /* Try class on this window */
-    if (XGetClassHint(dpy, win, &class_hints)) {
-        if (class_hints.res_class)
-            win_class = class_hints.res_class;
-    }
-
-    /* If title or class are empty, try the children (common when window is reparented) */
-    if ((!win_title || win_title[0] == '\0') || (!win_class || win_class[0] == '\0')) {
-        Window root_return, parent_return, *children = NULL;
-        unsigned int nchildren = 0;
-        if (XQueryTree(dpy, win, &root_return, &parent_return, &children, &nchildren)) {
-            for (unsigned int i = 0; i < nchildren; ++i) {
-                /* try to get a better title */
-                if ((!win_title || win_title[0] == '\0')) {
-                    char *child_title = NULL;
-                    if (fetch_window_title(dpy, children[i], &child_title) && child_title && child_title[0] != '\0') {
-                        free(win_title);
-                        win_title = child_title;
-                    } else {
-                        free(child_title);
-                    }
-                }
-                /* try to get a better class */
-                if ((!win_class || win_class[0] == '\0')) {
-                    XClassHint ch;
-                    if (XGetClassHint(dpy, children[i], &ch)) {
-                        if (ch.res_class) {
-                            if (win_class && win_class[0] != '\0') {
-                                /* keep existing */
-                                XFree(ch.res_class);
-                                XFree(ch.res_name);
-                            } else {
-                                win_class = ch.res_class;
-                                XFree(ch.res_name);
-                            }
-                        }
-                    }
-                }
-                if ((win_title && win_title[0] != '\0') && (win_class && win_class[0] != '\0'))
-                    break;
-            }
-            if (children)
-                XFree(children);
-        }
-    }
-
-    /* Normalize to non-NULL strings */
-    if (win_class) {
-        ans->class = win_class;
-    } else {
-        ans->class = strdup("");
-    }
-
-    if (win_title) {
-        ans->title = win_title;
-    } else {
-        ans->title = strdup("");
-    }
-
-    return ans;
-}
-
 static Window get_parent_window(Display *dpy, Window w)
 {
     Window root_return, parent_return, *child_return;
@@ -304,6 +277,33 @@ void grabbing_xinput_grab_start(Grabber *self)
 	}
 }
 
+/**
+ * Receive XI_RawMotion for the grabbed device while a gesture is drawn.
+ * Raw events are only delivered to root windows.
+ */
+static void grabbing_select_raw_motion(Grabber *self, int enable)
+{
+	unsigned char mask_data[XIMaskLen(XI_RawMotion)] = {
+		0,
+	};
+
+	if (enable)
+	{
+		XISetMask(mask_data, XI_RawMotion);
+	}
+
+	XIEventMask mask = {
+		self->deviceid, sizeof(mask_data), mask_data};
+
+	int count = XScreenCount(self->dpy);
+
+	int screen;
+	for (screen = 0; screen < count; screen++)
+	{
+		XISelectEvents(self->dpy, RootWindow(self->dpy, screen), &mask, 1);
+	}
+}
+
 void grabbing_xinput_grab_stop(Grabber *self)
 {
 
@@ -339,81 +339,6 @@ static void mouse_click(Display *display, int button, int x, int y)
 	XTestFakeButtonEvent(display, button, False, CurrentTime);
 }
 
-static Window get_window_under_pointer(Display *dpy)
-{
-
-    Window root_return, child_return;
-    int root_x_return, root_y_return;
-    int win_x_return, win_y_return;
-    unsigned int mask_return;
-    if (!XQueryPointer(dpy, DefaultRootWindow(dpy), &root_return, &child_return,
-                  &root_x_return, &root_y_return, &win_x_return, &win_y_return,
-                  &mask_return)) {
-        return None;
-    }
-
-    if (child_return == None) {
-        /* pointer is on root */
-        return DefaultRootWindow(dpy);
-    }
-
-    /* climb parents to the top-level window (parent == root) */
-    Window w = child_return;
-    Window parent = get_parent_window(dpy, w);
-    while (parent != None && parent != DefaultRootWindow(dpy)) {
-        w = parent;
-        parent = get_parent_window(dpy, w);
-    }
-
-    /* If the top-level window itself is not a client (no WM_STATE), try its children
-       and return the first child that looks like the real client (has WM_STATE). */
-    Atom wm_state = XInternAtom(dpy, "WM_STATE", False);
-    Atom net_wm_name = XInternAtom(dpy, "_NET_WM_NAME", False);
-
-    Atom actual_type;
-    int actual_format;
-    unsigned long nitems, bytes_after;
-    unsigned char *prop = NULL;
-
-    if (XGetWindowProperty(dpy, w, wm_state, 0, 0, False, AnyPropertyType,
-                           &actual_type, &actual_format, &nitems, &bytes_after,
-                           &prop) == Success && prop) {
-        XFree(prop);
-        return w; /* top-level has WM_STATE, use it */
-    }
-    if (prop) { XFree(prop); prop = NULL; }
-
-    /* query children and try to find a child with WM_STATE or _NET_WM_NAME */
-    Window rootr, parentr, *children = NULL;
-    unsigned int nchildren = 0;
-    if (XQueryTree(dpy, w, &rootr, &parentr, &children, &nchildren)) {
-        for (unsigned int i = 0; i < nchildren; ++i) {
-            Window c = children[i];
-            if (XGetWindowProperty(dpy, c, wm_state, 0, 0, False, AnyPropertyType,
-                                   &actual_type, &actual_format, &nitems, &bytes_after,
-                                   &prop) == Success && prop) {
-                XFree(prop);
-                XFree(children);
-                return c;
-            }
-            if (prop) { XFree(prop); prop = NULL; }
-
-            /* also try _NET_WM_NAME as a heuristic */
-            if (XGetWindowProperty(dpy, c, net_wm_name, 0, 0, False, AnyPropertyType,
-                                   &actual_type, &actual_format, &nitems, &bytes_after,
-                                   &prop) == Success && prop) {
-                XFree(prop);
-                XFree(children);
-                return c;
-            }
-            if (prop) { XFree(prop); prop = NULL; }
-        }
-        if (children) XFree(children);
-    }
-
-    return w;
-}
-
 static Window get_focused_window(Display *dpy)
 {
 
@@ -429,185 +354,39 @@ static Window get_focused_window(Display *dpy)
 	return win;
 }
 
-static void execute_action(Display *dpy, Action *action, Window focused_window)
-{
-	int id;
-
-	assert(dpy);
-	assert(action);
-	assert(focused_window);
-
-	switch (action->type)
-	{
-	case ACTION_EXECUTE:
-		id = fork();
-		if (id == 0)
-		{
-			int i = system(action->original_str);
-			exit(i);
-		}
-		if (id < 0)
-		{
-			fprintf(stderr, "Error forking.\n");
-		}
-
-		break;
-	case ACTION_ICONIFY:
-		action_iconify(dpy, focused_window);
-		break;
-	case ACTION_KILL:
-		action_kill(dpy, focused_window);
-		break;
-	case ACTION_RAISE:
-		action_raise(dpy, focused_window);
-		break;
-	case ACTION_LOWER:
-		action_lower(dpy, focused_window);
-		break;
-	case ACTION_MAXIMIZE:
-		action_maximize(dpy, focused_window);
-		break;
-	case ACTION_RESTORE:
-		action_restore(dpy, focused_window);
-		break;
-	case ACTION_TOGGLE_MAXIMIZED:
-		action_toggle_maximized(dpy, focused_window);
-		break;
-	case ACTION_KEYPRESS:
-		action_keypress(dpy, action->original_str);
-		break;
-	default:
-		fprintf(stderr, "found an unknown gesture \n");
-	}
-
-	XAllowEvents(dpy, 0, CurrentTime);
-
-	return;
-}
-
 static void free_grabbed(Capture *free_me)
 {
 	assert(free_me);
-	free(free_me->active_window_info);
+	free(free_me->expression_list);
 	free(free_me);
 }
 
-static char get_fine_direction_from_deltas(int x_delta, int y_delta)
+static int get_touch_status(XIDeviceInfo *device)
 {
 
-	if ((x_delta == 0) && (y_delta == 0))
-	{
-		return stroke_representations[NONE];
-	}
-
-	// check if the movement is near main axes
-	if ((x_delta == 0) || (y_delta == 0) || (fabs((float)x_delta / (float)y_delta) > 3) || (fabs((float)y_delta / (float)x_delta) > 3))
-	{
-
-		// x axe
-		if (abs(x_delta) > abs(y_delta))
-		{
-
-			if (x_delta > 0)
-			{
-				return stroke_representations[RIGHT];
-			}
-			else
-			{
-				return stroke_representations[LEFT];
-			}
-
-			// y axe
-		}
-		else
-		{
-
-			if (y_delta > 0)
-			{
-				return stroke_representations[DOWN];
-			}
-			else
-			{
-				return stroke_representations[UP];
-			}
-		}
-
-		// diagonal axes
-	}
-	else
-	{
-
-		if (y_delta < 0)
-		{
-			if (x_delta < 0)
-			{
-				return stroke_representations[SEVEN];
-			}
-			else if (x_delta > 0)
-			{ // RIGHT
-				return stroke_representations[NINE];
-			}
-		}
-		else if (y_delta > 0)
-		{ // DOWN
-			if (x_delta < 0)
-			{ // RIGHT
-				return stroke_representations[ONE];
-			}
-			else if (x_delta > 0)
-			{
-				return stroke_representations[THREE];
-			}
-		}
-	}
-
-	return stroke_representations[NONE];
-}
-
-static char get_direction_from_deltas(int x_delta, int y_delta)
-{
+	int j = 0;
 
-	if (abs(y_delta) > abs(x_delta))
-	{
-		if (y_delta > 0)
-		{
-			return stroke_representations[DOWN];
-		}
-		else
-		{
-			return stroke_representations[UP];
-		}
-	}
-	else
+	for (j = 0; j < device->num_classes; j++)
 	{
-		if (x_delta > 0)
-		{
-			return stroke_representations[RIGHT];
-		}
-		else
-		{
-			return stroke_representations[LEFT];
-		}
-	}
-}
+		XIAnyClassInfo *class = device->classes[j];
+		XITouchClassInfo *t = (XITouchClassInfo *)class;
 
-static void movement_add_direction(char *stroke_sequence, char direction)
-{
-	// grab stroke
-	int len = strlen(stroke_sequence);
-	if ((len == 0) || (stroke_sequence[len - 1] != direction))
-	{
+		if (class->type != XITouchClass)
+			continue;
 
-		if (len < MAX_STROKES_PER_CAPTURE)
+		if (t->mode == XIDirectTouch)
 		{
-
-			stroke_sequence[len] = direction;
-			stroke_sequence[len + 1] = '\0';
+			return 1;
 		}
 	}
+	return 0;
 }
 
-static int get_touch_status(XIDeviceInfo *device)
+/**
+ * Resolution of the first valuator in units per meter, or 0 if the device
+ * does not report one or is not a relative device.
+ */
+static int get_valuator_resolution(XIDeviceInfo *device)
 {
 
 	int j = 0;
@@ -615,14 +394,14 @@ static int get_touch_status(XIDeviceInfo *device)
 	for (j = 0; j < device->num_classes; j++)
 	{
 		XIAnyClassInfo *class = device->classes[j];
-		XITouchClassInfo *t = (XITouchClassInfo *)class;
+		XIValuatorClassInfo *v = (XIValuatorClassInfo *)class;
 
-		if (class->type != XITouchClass)
+		if (class->type != XIValuatorClass || v->number != 0)
 			continue;
 
-		if (t->mode == XIDirectTouch)
+		if (v->mode == XIModeRelative)
 		{
-			return 1;
+			return v->resolution;
 		}
 	}
 	return 0;
@@ -658,6 +437,7 @@ static void grabber_xinput_open_devices(Grabber *self, int verbose)
 				}
 				self->deviceid = device->deviceid;
 				self->is_direct_touch = get_touch_status(device);
+				self->valuator_resolution = get_valuator_resolution(device);
 			}
 			else
 			{
@@ -682,19 +462,30 @@ static void grabber_xinput_open_devices(Grabber *self, int verbose)
 /**
  * Clear previous movement data.
  */
-void grabbing_start_movement(Grabber *self, int new_x, int new_y)
+void grabbing_start_movement(Grabber *self, int new_x, int new_y, Time time)
 {
 
 	self->started = 1;
+	self->continuous_checked = 0;
 
-	self->fine_direction_sequence[0] = '\0';
-	self->rought_direction_sequence[0] = '\0';
+	int r;
+	for (r = 0; r < QUANTIZER_COUNT; r++)
+	{
+		stroke_buffer_clear(self->strokes[r]);
+	}
 
 	self->old_x = new_x;
 	self->old_y = new_y;
+	self->old_time = time;
 
-	self->rought_old_x = new_x;
-	self->rought_old_y = new_y;
+	self->raw_x = new_x;
+	self->raw_y = new_y;
+
+	if (self->path)
+	{
+		point_path_clear(self->path);
+		point_path_add(self->path, new_x, new_y, time);
+	}
 
 	if (self->brush_image)
 	{
@@ -706,14 +497,8 @@ void grabbing_start_movement(Grabber *self, int new_x, int new_y)
 	return;
 }
 
-void grabbing_update_movement(Grabber *self, int new_x, int new_y)
+static void grabbing_draw_movement(Grabber *self, int new_x, int new_y)
 {
-
-	if (!self->started)
-	{
-		return;
-	}
-
 	// se for o caso, desenha o movimento na tela
 	if (self->brush_image)
 	{
@@ -722,255 +507,1257 @@ void grabbing_update_movement(Grabber *self, int new_x, int new_y)
 
 		brush_line_to(&(self->brush), new_x, new_y);
 	}
+}
 
-	int x_delta = (new_x - self->old_x);
-	int y_delta = (new_y - self->old_y);
+/**
+ * The fine sequence with a '!' after each stroke whose average speed was
+ * above one delta_min per FAST_STROKE_MS.
+ */
+static void grabbing_build_speed_sequence(Grabber *self)
+{
+	StrokeBuffer *strokes = self->strokes[QUANTIZER_8];
+	char *sequence = self->speed_direction_sequence;
 
-	if ((abs(x_delta) > self->delta_min) || (abs(y_delta) > self->delta_min))
+	int len = 0;
+	int i;
+	for (i = 0; i < strokes->count; i++)
 	{
+		Stroke *stroke = &strokes->strokes[i];
 
-		char stroke = get_fine_direction_from_deltas(x_delta, y_delta);
-
-		movement_add_direction(self->fine_direction_sequence, stroke);
+		sequence[len++] = stroke->direction;
 
-		// reset start position
-		self->old_x = new_x;
-		self->old_y = new_y;
+		if (stroke->length * FAST_STROKE_MS >
+			(double)self->delta_min * stroke_get_duration(stroke))
+		{
+			sequence[len++] = '!';
+		}
 	}
 
-	int rought_delta_x = new_x - self->rought_old_x;
-	int rought_delta_y = new_y - self->rought_old_y;
+	sequence[len] = '\0';
+}
 
-	char rought_direction = get_direction_from_deltas(rought_delta_x,
-													  rought_delta_y);
+static void grabbing_classify_movement(Grabber *self, int new_x, int new_y,
+									   Time time)
+{
+	if (self->path)
+	{
+		point_path_add(self->path, new_x, new_y, time);
+	}
 
-	int square_distance_2 = rought_delta_x * rought_delta_x + rought_delta_y * rought_delta_y;
+	int x_delta = (new_x - self->old_x);
+	int y_delta = (new_y - self->old_y);
 
-	if (self->delta_min * self->delta_min < square_distance_2)
+	if ((abs(x_delta) > self->delta_min) || (abs(y_delta) > self->delta_min))
 	{
-		// grab stroke
+		/* one angle for all resolutions */
+		int bin = quantizer_get_bin(x_delta, y_delta);
+		double length = hypot(x_delta, y_delta);
+
+		int r;
+		for (r = 0; r < QUANTIZER_COUNT; r++)
+		{
+			if (!self->quantizer_enabled[r])
+				continue;
 
-		movement_add_direction(self->rought_direction_sequence,
-							   rought_direction);
+			StrokeBuffer *strokes = self->strokes[r];
+			Stroke *current = stroke_buffer_last(strokes);
+
+			char stroke = quantizer_get_direction(
+				r, bin, current ? current->direction : '\0',
+				STROKE_HYSTERESIS_BINS);
+
+			stroke_buffer_add_filtered(strokes, stroke, length, self->old_time,
+									   time, STROKE_COMMIT_LENGTH * self->delta_min);
+		}
 
 		// reset start position
-		self->rought_old_x = new_x;
-		self->rought_old_y = new_y;
+		self->old_x = new_x;
+		self->old_y = new_y;
+		self->old_time = time;
 	}
-
-	return;
 }
 
 /**
- *
+ * Replace the strokes found while moving by the segments of the
+ * simplified path, so the same shape gives the same sequence however
+ * fast or unevenly it was drawn.
  */
-void grabbing_end_movement(Grabber *self, int new_x, int new_y,
-						   char *device_name, Configuration *conf)
+static void grabbing_classify_path(Grabber *self)
 {
+	PointPath *path = self->path;
 
-	grabbing_xinput_grab_stop(self);
-
-	// Window focused_window = get_focused_window(self->dpy);
-	Window focused_window = get_window_under_pointer(self->dpy);
-	Window target_window = focused_window;
-
-	Capture *grab = NULL;
-
-	self->started = 0;
+	point_path_simplify(path, PATH_SIMPLIFY_TOLERANCE * self->delta_min);
 
-	// if is drawing
-	if (self->brush_image)
+	int r;
+	for (r = 0; r < QUANTIZER_COUNT; r++)
 	{
-		backing_restore(&(self->backing));
-	};
+		stroke_buffer_clear(self->strokes[r]);
+	}
 
-	// if there is no gesture
-	if ((strlen(self->rought_direction_sequence) == 0) && (strlen(self->fine_direction_sequence) == 0))
+	int i;
+	for (i = 1; i < path->count; i++)
 	{
+		PathPoint *from = &path->points[i - 1];
+		PathPoint *to = &path->points[i];
 
-		if (!(self->synaptics))
+		int x_delta = to->x - from->x;
+		int y_delta = to->y - from->y;
+		double length = hypot(x_delta, y_delta);
+
+		if (length < self->delta_min)
 		{
+			continue;
+		}
 
-			printf("\nEmulating click\n");
+		int bin = quantizer_get_bin(x_delta, y_delta);
 
-			//grabbing_xinput_grab_stop(self);
-			mouse_click(self->dpy, self->button, new_x, new_y);
-			//grabbing_xinput_grab_start(self);
+		for (r = 0; r < QUANTIZER_COUNT; r++)
+		{
+			if (self->quantizer_enabled[r])
+			{
+				stroke_buffer_add(self->strokes[r],
+								  quantizer_get_direction(r, bin, '\0', 0),
+								  length, from->time, to->time);
+			}
 		}
 	}
-	else
-	{
-
-		int expression_count = 2;
-		char **expression_list = malloc(sizeof(char *) * expression_count);
+}
 
-		expression_list[0] = self->fine_direction_sequence;
-		expression_list[1] = self->rought_direction_sequence;
+void grabbing_update_movement(Grabber *self, int new_x, int new_y, Time time)
+{
 
-		ActiveWindowInfo *window_info = get_active_window_info(self->dpy,
-															   target_window);
+	if (!self->started)
+	{
+		return;
+	}
 
-		grab = malloc(sizeof(Capture));
+	grabbing_draw_movement(self, new_x, new_y);
 
-		grab->expression_count = expression_count;
-		grab->expression_list = expression_list;
-		grab->active_window_info = window_info;
+	if (!self->raw_motion)
+	{
+		grabbing_classify_movement(self, new_x, new_y, time);
 	}
 
-	if (grab)
-	{
+	return;
+}
 
-		printf("\n");
-		printf("     Window title: \"%s\"\n", grab->active_window_info->title);
-		printf("     Window class: \"%s\"\n", grab->active_window_info->class);
-		printf("     Device      : \"%s\"\n", device_name);
+/**
+ * Raw mode: strokes are classified from the unaccelerated device deltas,
+ * the pointer position is only used for drawing.
+ */
+static void grabbing_update_raw_movement(Grabber *self, double delta_x,
+										 double delta_y, Time time)
+{
+	if (!self->started)
+	{
+		return;
+	}
+
+	self->raw_x += delta_x;
+	self->raw_y += delta_y;
+
+	grabbing_classify_movement(self, (int)self->raw_x, (int)self->raw_y, time);
+}
+
+/**
+ * Classify a motion event now but leave the drawing for
+ * grabbing_flush_movement, so a burst of queued events is drawn once.
+ */
+static void grabbing_queue_movement(Grabber *self, int new_x, int new_y,
+									Time time)
+{
+	if (!self->started)
+	{
+		return;
+	}
+
+	if (!self->raw_motion)
+	{
+		grabbing_classify_movement(self, new_x, new_y, time);
+	}
+
+	self->pending_x = new_x;
+	self->pending_y = new_y;
+	self->pending_count++;
+}
+
+/**
+ * Draw up to the newest queued point. When more events than
+ * MOTION_BACKLOG_DEGRADE were queued we are behind the device, so the
+ * drawing is skipped until the queue is short again; the next line drawn
+ * catches up with the pointer.
+ */
+static void grabbing_flush_movement(Grabber *self)
+{
+	if (!self->pending_count)
+	{
+		return;
+	}
+
+	if (self->pending_count <= MOTION_BACKLOG_DEGRADE && self->started)
+	{
+		grabbing_draw_movement(self, self->pending_x, self->pending_y);
+	}
+
+	self->pending_count = 0;
+}
+
+static void grabbing_match_target_contexts(Grabber *self, Configuration *conf)
+{
+	ActiveWindowInfo *window_info = window_cache_get_info(self->window_cache,
+														  self->target_window);
+
+	self->target_context_list = realloc(self->target_context_list,
+										sizeof(Context *) * (conf->context_count + 1));
+	self->target_context_count = configuration_match_contexts(conf, window_info,
+															  self->target_context_list);
+	self->target_generation = self->window_cache->generation;
+}
+
+/**
+ * Start resolving the window the gesture is drawn over. This is called when
+ * the movement starts, so lookups that need the server overlap with the
+ * stroke. With no event at hand (root == None) the pointer is queried.
+ */
+void grabbing_set_target(Grabber *self, Window root, Window child,
+						 Configuration *conf)
+{
+	self->target_context_count = -1;
+
+	if (root == None)
+	{
+		self->target_window = window_cache_get_client_under_pointer(
+			self->window_cache);
+	}
+	else
+	{
+		self->target_window = window_cache_start_lookup(self->window_cache,
+														root, child);
+	}
+
+	/* window already known: match the contexts now */
+	if (self->target_window != None)
+	{
+		grabbing_match_target_contexts(self, conf);
+	}
+}
+
+/**
+ * Collect the target lookup started by grabbing_set_target. Only reads
+ * memory unless the replies are still on their way.
+ */
+static ActiveWindowInfo *grabbing_resolve_target(Grabber *self,
+												 Configuration *conf)
+{
+	if (self->target_window == None)
+	{
+		self->target_window = window_cache_finish_lookup(self->window_cache);
+	}
+
+	if (self->target_window == None)
+	{
+		self->target_window = window_cache_get_client_under_pointer(
+			self->window_cache);
+	}
+
+	/* window info changed during the stroke */
+	if (self->target_context_count < 0 ||
+		self->target_generation != self->window_cache->generation)
+	{
+		grabbing_match_target_contexts(self, conf);
+	}
+
+	return window_cache_get_info(self->window_cache, self->target_window);
+}
+
+/*
+ * Fire one repeat of the continuous gesture, if one is owed. Repeats are
+ * paced by this timer, however fast the movement is.
+ */
+static void grabbing_on_continuous_timer(void *data)
+{
+	Grabber *self = data;
+
+	if (!self->continuous_owed || !self->continuous_gesture)
+	{
+		reactor_timer_stop(self->continuous_timer);
+		self->continuous_ticking = 0;
+		return;
+	}
+
+	self->continuous_owed--;
+
+	/* repeats skipped for the in-flight limit do not count */
+	if (dispatcher_push_gesture(self->dispatcher, self->continuous_gesture,
+								self->target_window) > 0)
+	{
+		self->continuous_fired++;
+	}
+}
+
+static void grabbing_lock_continuous(Grabber *self, Gesture *gest, int r)
+{
+	if (gest != self->continuous_gesture)
+	{
+		printf("     Following continuous gesture '%s'\n", gest->name);
+	}
+
+	self->continuous_gesture = gest;
+	self->continuous_resolution = r;
+	self->continuous_stroke = self->strokes[r]->count - 1;
+	self->continuous_steps = 0;
+}
+
+/*
+ * Whether a gesture that is not continuous could still be drawn from the
+ * strokes so far, at either resolution a movement may be written in.
+ */
+static int grabbing_other_gesture_possible(Grabber *self)
+{
+	static const int resolutions[] = {QUANTIZER_8, QUANTIZER_4};
+
+	int i;
+	for (i = 0; i < 2; i++)
+	{
+		if (configuration_can_extend(
+				self->conf, self->strokes[resolutions[i]]->sequence,
+				self->target_context_list, self->target_context_count,
+				quantizer_resolutions[resolutions[i]].symbols))
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Lock onto a continuous gesture once the strokes drawn so far match it
+ * and cannot become any other gesture any more. After that, each new stroke that is a continuous gesture by itself
+ * takes over, e.g. going down after going up. The length of the followed
+ * stroke decides how many repeats are owed.
+ */
+static void grabbing_update_continuous(Grabber *self)
+{
+	if (!self->started || !self->conf->continuous_gesture_count)
+	{
+		return;
+	}
+
+	int checked = self->strokes[QUANTIZER_8]->count +
+				  self->strokes[QUANTIZER_4]->count;
+
+	if (!self->continuous_gesture && checked != self->continuous_checked)
+	{
+		self->continuous_checked = checked;
+
+		/* the contexts are known once the target window is */
+		grabbing_resolve_target(self, self->conf);
+
+		static const int resolutions[] = {QUANTIZER_8, QUANTIZER_4};
+
+		int i;
+		for (i = 0; i < 2 && !self->continuous_gesture; i++)
+		{
+			StrokeBuffer *strokes = self->strokes[resolutions[i]];
+			Gesture *gest = configuration_match_continuous(
+				self->conf, strokes->sequence, self->target_context_list,
+				self->target_context_count);
+
+			if (strokes->count && gest &&
+				!grabbing_other_gesture_possible(self))
+			{
+				grabbing_lock_continuous(self, gest, resolutions[i]);
+			}
+		}
+	}
+
+	if (!self->continuous_gesture)
+	{
+		return;
+	}
+
+	StrokeBuffer *strokes = self->strokes[self->continuous_resolution];
+
+	if (strokes->count - 1 != self->continuous_stroke)
+	{
+		char last[2] = {stroke_buffer_last(strokes)->direction, '\0'};
+
+		Gesture *gest = configuration_match_continuous(
+			self->conf, last, self->target_context_list,
+			self->target_context_count);
+
+		/* other strokes do not count */
+		if (!gest)
+		{
+			return;
+		}
+
+		grabbing_lock_continuous(self, gest, self->continuous_resolution);
+	}
+
+	Gesture *gest = self->continuous_gesture;
+	Stroke *stroke = &strokes->strokes[self->continuous_stroke];
+
+	double step = gest->continuous_step > 0 ? gest->continuous_step
+											: self->delta_min;
+	int steps = stroke->length / step;
+
+	if (steps <= self->continuous_steps)
+	{
+		return;
+	}
+
+	/* coalesce: a fast movement does not build up a backlog */
+	self->continuous_owed += steps - self->continuous_steps;
+	if (self->continuous_owed > CONTINUOUS_MAX_OWED)
+	{
+		self->continuous_owed = CONTINUOUS_MAX_OWED;
+	}
+	self->continuous_steps = steps;
+
+	if (!self->continuous_ticking)
+	{
+		if (!self->continuous_timer)
+		{
+			self->continuous_timer = reactor_add_timer(
+				self->reactor, grabbing_on_continuous_timer, self);
+		}
+
+		self->continuous_ticking = 1;
+		grabbing_on_continuous_timer(self);
+		reactor_timer_start(self->continuous_timer, CONTINUOUS_INTERVAL_MS,
+							CONTINUOUS_INTERVAL_MS);
+	}
+}
+
+static void grabbing_end_continuous(Grabber *self)
+{
+	if (self->continuous_ticking)
+	{
+		reactor_timer_stop(self->continuous_timer);
+		self->continuous_ticking = 0;
+	}
+
+	printf("     Continuous gesture '%s' repeated %d times\n\n",
+		   self->continuous_gesture->name, self->continuous_fired);
+
+	self->continuous_gesture = NULL;
+	self->continuous_owed = 0;
+	self->continuous_fired = 0;
+}
+
+/**
+ *
+ */
+void grabbing_end_movement(Grabber *self, int new_x, int new_y,
+						   char *device_name, Configuration *conf)
+{
+
+	grabbing_xinput_grab_stop(self);
+
+	Capture *grab = NULL;
+
+	self->started = 0;
+
+	// if is drawing
+	if (self->brush_image)
+	{
+		backing_restore(&(self->backing));
+	};
+
+	/* a last stroke shorter than a committed one still counts */
+	int r;
+	for (r = 0; r < QUANTIZER_COUNT; r++)
+	{
+		if (self->quantizer_enabled[r])
+			stroke_buffer_flush_candidate(self->strokes[r], self->delta_min);
+	}
+
+	if (self->path)
+	{
+		grabbing_classify_path(self);
+	}
+
+	// the gesture already ran while moving
+	if (self->continuous_gesture)
+	{
+		grabbing_end_continuous(self);
+	}
+	// if there is no gesture
+	else if ((self->strokes[QUANTIZER_4]->count == 0) && (self->strokes[QUANTIZER_8]->count == 0))
+	{
+
+		if (!(self->synaptics))
+		{
+
+			printf("\nEmulating click\n");
+
+			//grabbing_xinput_grab_stop(self);
+			mouse_click(self->dpy, self->button, new_x, new_y);
+			//grabbing_xinput_grab_start(self);
+		}
+	}
+	else
+	{
+
+		if (self->strokes[QUANTIZER_8]->truncated)
+		{
+			printf("\nGesture has more than %d strokes. The rest was ignored.\n",
+				   MAX_STROKES_PER_CAPTURE);
+		}
+
+		grabbing_build_speed_sequence(self);
+
+		int expression_count = 0;
+		char **expression_list = malloc(sizeof(char *) * (QUANTIZER_COUNT + 1));
+
+		/* only differs from the fine sequence if there was a flick */
+		if (strchr(self->speed_direction_sequence, '!'))
+		{
+			expression_list[expression_count++] = self->speed_direction_sequence;
+		}
+		expression_list[expression_count++] = self->strokes[QUANTIZER_8]->sequence;
+		expression_list[expression_count++] = self->strokes[QUANTIZER_4]->sequence;
+
+		/* only used by movements written with their symbols */
+		if (self->quantizer_enabled[QUANTIZER_12])
+		{
+			expression_list[expression_count++] = self->strokes[QUANTIZER_12]->sequence;
+		}
+		if (self->quantizer_enabled[QUANTIZER_16])
+		{
+			expression_list[expression_count++] = self->strokes[QUANTIZER_16]->sequence;
+		}
+
+		ActiveWindowInfo *window_info = grabbing_resolve_target(self, conf);
+
+		grab = malloc(sizeof(Capture));
+
+		grab->expression_count = expression_count;
+		grab->expression_list = expression_list;
+		grab->active_window_info = window_info;
+		grab->context_list = self->target_context_list;
+		grab->context_count = self->target_context_count;
+	}
+
+	if (grab)
+	{
+
+		printf("\n");
+		printf("     Window title: \"%s\"\n", grab->active_window_info->title);
+		printf("     Window class: \"%s\"\n", grab->active_window_info->class);
+		printf("     Device      : \"%s\"\n", device_name);
+
+		Gesture *gest = configuration_process_gesture(conf, grab);
+
+		if (gest)
+		{
+			printf("     Movement '%s' matched gesture '%s' on context '%s'\n",
+				   gest->movement->name, gest->name, gest->context->name);
+
+			int j = 0;
+
+			for (j = 0; j < gest->action_count; ++j)
+			{
+				Action *a = gest->action_list[j];
+				printf("     Executing action: %s %s\n",
+					   get_action_name(a->type), a->original_str);
+
+				if (a->type == ACTION_RECONF)
+				{
+					grabber_reload(self);
+				}
+			}
+
+			dispatcher_push_gesture(self->dispatcher, gest,
+									self->target_window);
+
+			XAllowEvents(self->dpy, 0, CurrentTime);
+		}
+		else
+		{
+
+			for (int i = 0; i < grab->expression_count; ++i)
+			{
+				char *movement = grab->expression_list[i];
+				printf(
+					"     Sequence '%s' does not match any known movement.\n",
+					movement);
+			}
+		}
+
+		printf("\n");
+
+		free_grabbed(grab);
+	}
+
+	grabbing_xinput_grab_start(self);
+}
+
+void grabber_set_button(Grabber *self, int button)
+{
+	self->button = button;
+}
+
+void grabber_set_device(Grabber *self, char *device_name)
+{
+	self->devicename = device_name;
+
+	if (strcasecmp(self->devicename, "SYNAPTICS") == 0)
+	{
+		self->synaptics = 1;
+		self->delta_min = 200;
+	}
+	else
+	{
+		self->synaptics = 0;
+		self->delta_min = 30;
+	}
+}
+
+/**
+ * Use a fixed stroke length instead of deriving it from the hardware.
+ */
+void grabber_set_delta_min(Grabber *self, int delta_min)
+{
+	if (delta_min > 0)
+	{
+		self->delta_min = delta_min;
+		self->delta_min_fixed = 1;
+	}
+}
+
+void grabber_set_simplify_path(Grabber *self, int enable)
+{
+	if (enable && !self->path)
+	{
+		self->path = point_path_new(PATH_CAPACITY);
+	}
+	else if (!enable && self->path)
+	{
+		point_path_free(self->path);
+		self->path = NULL;
+	}
+}
+
+void grabber_set_raw_motion(Grabber *self, int enable)
+{
+	/* synaptics positions are polled, there are no raw events */
+	self->raw_motion = enable && !self->synaptics;
+}
+
+void grabber_set_brush_color(Grabber *self, char *brush_color)
+{
+	self->brush_image = get_brush_image(brush_color);
+}
+
+/*
+ * Launch programs through the helper at the other end of launcher_fd.
+ */
+void grabber_set_launcher(Grabber *self, int launcher_fd)
+{
+	self->launcher_fd = launcher_fd;
+}
+
+/*
+ * Share the limit of actions in flight with the grabbers of other devices.
+ */
+void grabber_set_in_flight_counter(Grabber *self, int *counter)
+{
+	self->in_flight_counter = counter;
+}
+
+/*
+ * Programs launched by the helper ended.
+ */
+static void grabber_on_launcher(void *data, int fd, uint32_t events)
+{
+	Grabber *self = data;
+	LauncherExit report;
+	int ret;
+
+	/* the dispatcher was done with them as soon as they started */
+	while ((ret = launcher_read_exit(fd, &report)) > 0)
+		;
+
+	if (ret == 0)
+	{
+		printf("Launcher helper exited, launching programs directly.\n");
+		dispatcher_set_launcher(self->dispatcher, -1);
+		reactor_remove(self->reactor, self->launcher_source);
+		self->launcher_source = NULL;
+	}
+}
+
+/*
+ * Reap launched programs. SIGCHLD is delivered through a signalfd and
+ * several exits may be reported by a single signal.
+ */
+static void grabber_on_child(void *data, struct signalfd_siginfo *info)
+{
+	int status;
+
+	while (waitpid(-1, &status, WNOHANG) > 0)
+		;
+}
+
+Grabber *grabber_new(char *device_name, int button)
+{
+
+	Grabber *self = malloc(sizeof(Grabber));
+	bzero(self, sizeof(Grabber));
+
+	quantizer_init();
+
+	int r;
+	for (r = 0; r < QUANTIZER_COUNT; r++)
+	{
+		self->strokes[r] = stroke_buffer_new(MAX_STROKES_PER_CAPTURE);
+	}
+
+	self->quantizer_enabled[QUANTIZER_4] = 1;
+	self->quantizer_enabled[QUANTIZER_8] = 1;
+	self->speed_direction_sequence = malloc(2 * MAX_STROKES_PER_CAPTURE + 1);
+
+	grabber_set_device(self, device_name);
+	grabber_set_button(self, button);
+
+	self->reactor = reactor_new();
+	self->control_fd = -1;
+	self->launcher_fd = -1;
+	self->reload_fd = -1;
+
+	static const int child_signals[] = {SIGCHLD};
+	reactor_add_signals(self->reactor, child_signals, 1, grabber_on_child,
+						self);
+
+	return self;
+}
+
+char *get_device_name_from_event(Grabber *self, XIDeviceEvent *data)
+{
+	int ndevices;
+	char *device_name = NULL;
+	XIDeviceInfo *device;
+	XIDeviceInfo *devices;
+	devices = XIQueryDevice(self->dpy, data->deviceid, &ndevices);
+	if (ndevices == 1)
+	{
+		device = &devices[0];
+		device_name = strdup(device->name);
+	}
+
+	return device_name;
+}
+
+void grabber_list_devices(Grabber *self)
+{
+	grabber_xinput_open_devices(self, True);
+};
+
+static void grabber_xinput_handle_event(Grabber *self, XEvent *ev)
+{
+	Configuration *conf = self->conf;
+
+	if (!XGetEventData(self->dpy, &ev->xcookie))
+	{
+		return;
+	}
+
+	XIDeviceEvent *data = NULL;
+
+	switch (ev->xcookie.evtype)
+	{
+
+	case XI_ButtonPress:
+		data = (XIDeviceEvent *)ev->xcookie.data;
+		grabbing_start_movement(self, data->root_x, data->root_y, data->time);
+		if (self->raw_motion)
+		{
+			grabbing_select_raw_motion(self, True);
+		}
+		grabbing_set_target(self, data->root, data->child, conf);
+		break;
+
+	case XI_ButtonRelease:
+		data = (XIDeviceEvent *)ev->xcookie.data;
+
+		char *device_name = get_device_name_from_event(self, data);
+
+		if (self->raw_motion)
+		{
+			grabbing_select_raw_motion(self, False);
+		}
 
-		Gesture *gest = configuration_process_gesture(conf, grab);
+		grabbing_xinput_grab_stop(self);
+		grabbing_end_movement(self, data->root_x, data->root_y,
+							  device_name, conf);
+		grabbing_xinput_grab_start(self);
+		break;
+	}
 
-		if (gest)
+	XFreeEventData(self->dpy, &ev->xcookie);
+}
+
+/*
+ * Handle every event Xlib has queued or can read without blocking. Events
+ * may be queued while waiting for a reply, without the socket becoming
+ * readable again, so this also runs before each wait. Every motion event
+ * is classified, but only the newest of a run is drawn.
+ */
+static void grabber_swap_configuration(Grabber *self, Configuration *conf);
+
+static void grabber_drain_events(Grabber *self)
+{
+	XEvent ev;
+
+	while (!self->shut_down && XPending(self->dpy))
+	{
+		XNextEvent(self->dpy, &ev);
+
+		if (ev.type == XI_MOTION_EVENT)
 		{
-			printf("     Movement '%s' matched gesture '%s' on context '%s'\n",
-				   gest->movement->name, gest->name, gest->context->name);
+			XIMotionEvent *motion = (XIMotionEvent *)&ev;
+			grabbing_queue_movement(self, motion->root_x, motion->root_y,
+									motion->time);
+			continue;
+		}
 
-			int j = 0;
+		if (ev.type == XI_RAW_MOTION_EVENT)
+		{
+			XIRawMotionEvent *raw = (XIRawMotionEvent *)&ev;
+			grabbing_update_raw_movement(self, raw->delta_x, raw->delta_y,
+										 raw->time);
+			continue;
+		}
 
-			for (j = 0; j < gest->action_count; ++j)
-			{
-				Action *a = gest->action_list[j];
-				printf("     Executing action: %s %s\n",
-					   get_action_name(a->type), a->original_str);
-				execute_action(self->dpy, a, target_window);
-			}
+		/* the trail must be up to date before a release restores the screen */
+		grabbing_flush_movement(self);
+
+		if (ev.xcookie.type == GenericEvent && ev.xcookie.extension == self->opcode)
+		{
+			grabber_xinput_handle_event(self, &ev);
 		}
 		else
 		{
+			window_cache_handle_event(self->window_cache, &ev);
+		}
+	}
+
+	grabbing_flush_movement(self);
+
+	/* once per batch of events, which coalesces the repeats */
+	grabbing_update_continuous(self);
+
+	/* a reloaded configuration waits for the gesture to end */
+	if (self->pending_conf && !self->started)
+	{
+		grabber_swap_configuration(self, self->pending_conf);
+		self->pending_conf = NULL;
+	}
+}
+
+static void grabber_on_x_readable(void *data, int fd, uint32_t events)
+{
+	grabber_drain_events((Grabber *)data);
+}
+
+static void grabber_on_prepare(void *data)
+{
+	grabber_drain_events((Grabber *)data);
+}
+
+/**
+ * Physical pixel density of the primary monitor (or the first one found),
+ * falling back to what the core protocol reports for the screen.
+ */
+static double grabber_get_pixels_per_mm(Grabber *self)
+{
+	Window root = DefaultRootWindow(self->dpy);
+	double pixels_per_mm = 0;
+
+	int event_base, error_base;
+	XRRScreenResources *resources = NULL;
+
+	if (XRRQueryExtension(self->dpy, &event_base, &error_base))
+	{
+		resources = XRRGetScreenResourcesCurrent(self->dpy, root);
+	}
+
+	if (resources)
+	{
+		RROutput primary = XRRGetOutputPrimary(self->dpy, root);
+
+		int i;
+		for (i = 0; i < resources->noutput; i++)
+		{
+			XRROutputInfo *output = XRRGetOutputInfo(self->dpy, resources,
+													 resources->outputs[i]);
 
-			for (int i = 0; i < grab->expression_count; ++i)
+			if (output && output->connection == RR_Connected && output->crtc)
 			{
-				char *movement = grab->expression_list[i];
-				printf(
-					"     Sequence '%s' does not match any known movement.\n",
-					movement);
+				XRRCrtcInfo *crtc = XRRGetCrtcInfo(self->dpy, resources,
+												   output->crtc);
+
+				/* mm_width is measured before the output is rotated */
+				int rotated = crtc && (crtc->rotation & (RR_Rotate_90 | RR_Rotate_270));
+				unsigned long mm = rotated ? output->mm_height : output->mm_width;
+
+				if (crtc && mm > 0 &&
+					(pixels_per_mm == 0 || resources->outputs[i] == primary))
+				{
+					pixels_per_mm = (double)crtc->width / mm;
+				}
+
+				if (crtc)
+					XRRFreeCrtcInfo(crtc);
 			}
+
+			if (output)
+				XRRFreeOutputInfo(output);
 		}
 
-		printf("\n");
+		XRRFreeScreenResources(resources);
+	}
 
-		free_grabbed(grab);
+	if (pixels_per_mm == 0)
+	{
+		int screen = DefaultScreen(self->dpy);
+
+		if (DisplayWidthMM(self->dpy, screen) > 0)
+		{
+			pixels_per_mm = (double)DisplayWidth(self->dpy, screen) /
+							DisplayWidthMM(self->dpy, screen);
+		}
 	}
 
-	grabbing_xinput_grab_start(self);
+	return pixels_per_mm;
 }
 
-void grabber_set_button(Grabber *self, int button)
+/**
+ * Derive the stroke length in pixels, or in device units when classifying
+ * raw motion, so gestures have the same physical size on any hardware.
+ */
+static void grabber_init_delta_min(Grabber *self)
 {
-	self->button = button;
-}
+	if (self->delta_min_fixed)
+	{
+		return;
+	}
 
-void grabber_set_device(Grabber *self, char *device_name)
-{
-	self->devicename = device_name;
+	double units_per_mm = 0;
 
-	if (strcasecmp(self->devicename, "SYNAPTICS") == 0)
+	if (self->raw_motion && self->valuator_resolution > 0)
 	{
-		self->synaptics = 1;
-		self->delta_min = 200;
+		units_per_mm = self->valuator_resolution / 1000.0;
 	}
 	else
 	{
-		self->synaptics = 0;
-		self->delta_min = 30;
+		units_per_mm = grabber_get_pixels_per_mm(self);
+	}
+
+	if (units_per_mm > 0)
+	{
+		self->delta_min = lround(STROKE_LENGTH_MM * units_per_mm);
+	}
+
+	if (self->delta_min < 1)
+	{
+		self->delta_min = 1;
 	}
 }
 
-void grabber_set_brush_color(Grabber *self, char *brush_color)
+void grabber_xinput_loop(Grabber *self, Configuration *conf)
 {
-	self->brush_image = get_brush_image(brush_color);
+	grabber_xinput_open_devices(self, False);
+	grabber_init_delta_min(self);
+	grabbing_xinput_grab_start(self);
+
+	reactor_run(self->reactor);
 }
 
-Grabber *grabber_new(char *device_name, int button)
+/*
+ * Whether a control message was sent by a process of our own user. The
+ * abstract namespace has no permissions, so anyone may send to the socket.
+ */
+static int grabber_control_sender_allowed(struct msghdr *msg)
 {
+	struct cmsghdr *cmsg;
 
-	Grabber *self = malloc(sizeof(Grabber));
-	bzero(self, sizeof(Grabber));
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET &&
+			cmsg->cmsg_type == SCM_CREDENTIALS)
+		{
+			struct ucred cred;
+			memcpy(&cred, CMSG_DATA(cmsg), sizeof(cred));
+			return cred.uid == getuid();
+		}
+	}
 
-	self->fine_direction_sequence = malloc(sizeof(char *) * 30);
-	self->rought_direction_sequence = malloc(sizeof(char *) * 30);
+	return 0;
+}
 
-	grabber_set_device(self, device_name);
-	grabber_set_button(self, button);
+/*
+ * Listen for commands from other processes on an abstract unix socket.
+ */
+static void grabber_on_control(void *data, int fd, uint32_t events)
+{
+	Grabber *self = data;
+	char command[256];
+	ssize_t len;
 
-	return self;
+	union
+	{
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(struct ucred))];
+	} control;
+
+	struct iovec iov = {command, sizeof(command) - 1};
+
+	struct msghdr msg;
+	bzero(&msg, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	while ((len = recvmsg(fd, &msg, 0)) > 0)
+	{
+		int allowed = grabber_control_sender_allowed(&msg);
+		msg.msg_controllen = sizeof(control.buffer);
+
+		if (!allowed)
+		{
+			fprintf(stderr, "Ignoring a control message from another user.\n");
+			continue;
+		}
+
+		command[len] = '\0';
+		command[strcspn(command, "\r\n")] = '\0';
+
+		if (strcmp(command, "quit") == 0)
+		{
+			printf("Asked to exit by a control message.\n");
+			grabber_stop(self);
+		}
+		else if (strcmp(command, "reload") == 0)
+		{
+			grabber_reload(self);
+		}
+		else
+		{
+			fprintf(stderr, "Unknown control message '%s'.\n", command);
+		}
+	}
 }
 
-char *get_device_name_from_event(Grabber *self, XIDeviceEvent *data)
+void grabber_listen_control(Grabber *self, char *name)
 {
-	int ndevices;
-	char *device_name = NULL;
-	XIDeviceInfo *device;
-	XIDeviceInfo *devices;
-	devices = XIQueryDevice(self->dpy, data->deviceid, &ndevices);
-	if (ndevices == 1)
+	struct sockaddr_un addr;
+	bzero(&addr, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+
+	/* abstract namespace: nothing to clean up on exit */
+	strncpy(addr.sun_path + 1, name, sizeof(addr.sun_path) - 2);
+	socklen_t addr_len = offsetof(struct sockaddr_un, sun_path) + 1 + strlen(addr.sun_path + 1);
+
+	int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+	/* the sender's uid comes with each message */
+	int passcred = 1;
+
+	if (fd < 0 ||
+		setsockopt(fd, SOL_SOCKET, SO_PASSCRED, &passcred,
+				   sizeof(passcred)) != 0 ||
+		bind(fd, (struct sockaddr *)&addr, addr_len) != 0)
 	{
-		device = &devices[0];
-		device_name = strdup(device->name);
+		perror("In control socket");
+		if (fd >= 0)
+			close(fd);
+		return;
 	}
 
-	return device_name;
+	self->control_fd = fd;
+	reactor_add_fd(self->reactor, fd, EPOLLIN, grabber_on_control, self);
 }
 
-void grabber_list_devices(Grabber *self)
+void grabber_stop(Grabber *self)
 {
-	grabber_xinput_open_devices(self, True);
-};
+	self->shut_down = 1;
+	reactor_stop(self->reactor);
+}
 
-void grabber_xinput_loop(Grabber *self, Configuration *conf)
+/**
+ * Classify with 12 or 16 sectors only if some movement uses their symbols.
+ */
+static void grabber_enable_quantizers(Grabber *self, Configuration *conf)
 {
+	int r;
+	for (r = QUANTIZER_12; r < QUANTIZER_COUNT; r++)
+	{
+		self->quantizer_enabled[r] = 0;
 
-	XEvent ev;
+		int i;
+		for (i = 0; i < conf->movement_count; i++)
+		{
+			if (quantizer_uses_alphabet(r, conf->movement_list[i]->expression))
+			{
+				self->quantizer_enabled[r] = 1;
+				break;
+			}
+		}
+	}
+}
 
-	grabber_xinput_open_devices(self, False);
-	grabbing_xinput_grab_start(self);
+/**
+ * Apply the <device> element for this device, if any.
+ */
+static void grabber_apply_device_settings(Grabber *self, Configuration *conf)
+{
+	DeviceSettings *settings = configuration_find_device(conf,
+														 self->devicename);
 
-	while (!self->shut_down)
+	if (settings && settings->delta_min > 0)
 	{
+		grabber_set_delta_min(self, settings->delta_min);
+	}
+	else if (self->delta_min_fixed && !self->synaptics)
+	{
+		self->delta_min_fixed = 0;
+		grabber_init_delta_min(self);
+	}
+}
 
-		XNextEvent(self->dpy, &ev);
+/*
+ * Use a new configuration from now on. Must not be called during a
+ * gesture. Actions still queued keep the old one alive until they ran.
+ */
+static void grabber_swap_configuration(Grabber *self, Configuration *conf)
+{
+	Configuration *old = self->conf;
 
-		if (ev.xcookie.type == GenericEvent && ev.xcookie.extension == self->opcode && XGetEventData(self->dpy, &ev.xcookie))
-		{
+	self->conf = conf;
+	grabber_enable_quantizers(self, conf);
+	grabber_apply_device_settings(self, conf);
 
-			XIDeviceEvent *data = NULL;
+	/* the matched contexts point into the old configuration */
+	self->target_context_count = -1;
 
-			switch (ev.xcookie.evtype)
-			{
+	configuration_unref(old);
 
-			case XI_Motion:
-				data = (XIDeviceEvent *)ev.xcookie.data;
-				grabbing_update_movement(self, data->root_x, data->root_y);
-				break;
+	printf("Configuration reloaded: %i gestures.\n",
+		   configuration_get_gestures_count(conf));
+}
 
-			case XI_ButtonPress:
-				data = (XIDeviceEvent *)ev.xcookie.data;
-				grabbing_start_movement(self, data->root_x, data->root_y);
-				break;
+static void *grabber_reload_thread(void *data)
+{
+	Grabber *self = data;
+
+	Configuration *conf = configuration_new();
+
+	if (configuration_load_from_file(conf, self->config_file) != 0)
+	{
+		configuration_unref(conf);
+		conf = NULL;
+	}
 
-			case XI_ButtonRelease:
-				data = (XIDeviceEvent *)ev.xcookie.data;
+	self->reloaded_conf = conf;
 
-				char *device_name = get_device_name_from_event(self, data);
+	uint64_t one = 1;
+	if (write(self->reload_fd, &one, sizeof(one)) < 0)
+	{
+		perror("Finishing the configuration reload");
+	}
 
-				grabbing_xinput_grab_stop(self);
-				grabbing_end_movement(self, data->root_x, data->root_y,
-									  device_name, conf);
-				grabbing_xinput_grab_start(self);
-				break;
-			}
-		}
-		XFreeEventData(self->dpy, &ev.xcookie);
+	return NULL;
+}
+
+static void grabber_on_reloaded(void *data, int fd, uint32_t events)
+{
+	Grabber *self = data;
+	uint64_t count;
+
+	if (read(fd, &count, sizeof(count)) < 0)
+	{
+		return;
+	}
+
+	pthread_join(self->reload_thread, NULL);
+	self->reloading = 0;
+
+	Configuration *conf = self->reloaded_conf;
+	self->reloaded_conf = NULL;
+
+	if (!conf)
+	{
+		printf("Keeping the current configuration.\n");
+	}
+	else if (self->started)
+	{
+		configuration_unref(self->pending_conf);
+		self->pending_conf = conf;
+	}
+	else
+	{
+		grabber_swap_configuration(self, conf);
+	}
+
+	if (self->reload_requested)
+	{
+		self->reload_requested = 0;
+		grabber_reload(self);
+	}
+}
+
+void grabber_set_config_file(Grabber *self, char *filename)
+{
+	free(self->config_file);
+	self->config_file = strdup(filename);
+}
+
+/**
+ * Parse the configuration file again, on a thread so that gestures are
+ * not held up, and use it once no gesture is being drawn.
+ */
+void grabber_reload(Grabber *self)
+{
+	if (!self->config_file)
+	{
+		return;
+	}
+
+	/* the file changed again while it was being parsed */
+	if (self->reloading)
+	{
+		self->reload_requested = 1;
+		return;
+	}
+
+	printf("Reloading configuration from '%s'.\n", self->config_file);
+
+	/* signals are taken by the reactor's signalfd, never by the thread */
+	sigset_t all, old;
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	int err = pthread_create(&self->reload_thread, NULL,
+							 grabber_reload_thread, self);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (err != 0)
+	{
+		fprintf(stderr, "Cannot reload the configuration: %s\n",
+				strerror(err));
+		return;
 	}
+
+	self->reloading = 1;
 }
 
+/*
+ * Run until stopped. The grabber takes over the caller's reference to conf.
+ */
 void grabber_loop(Grabber *self, Configuration *conf)
 {
 
@@ -978,6 +1765,33 @@ void grabber_loop(Grabber *self, Configuration *conf)
 
 	grabber_init_drawing(self);
 
+	self->dispatcher = dispatcher_new();
+
+	if (self->in_flight_counter)
+	{
+		dispatcher_set_in_flight_counter(self->dispatcher,
+										 self->in_flight_counter);
+	}
+
+	if (self->launcher_fd >= 0)
+	{
+		dispatcher_set_launcher(self->dispatcher, self->launcher_fd);
+		self->launcher_source = reactor_add_fd(self->reactor, self->launcher_fd,
+											   EPOLLIN, grabber_on_launcher,
+											   self);
+	}
+
+	self->conf = conf;
+	grabber_enable_quantizers(self, conf);
+
+	self->reload_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	reactor_add_fd(self->reactor, self->reload_fd, EPOLLIN,
+				   grabber_on_reloaded, self);
+
+	reactor_add_fd(self->reactor, ConnectionNumber(self->dpy), EPOLLIN,
+				   grabber_on_x_readable, self);
+	reactor_set_prepare(self->reactor, grabber_on_prepare, self);
+
 	if (self->synaptics)
 	{
 		grabber_synaptics_loop(self, conf);
@@ -1003,6 +1817,31 @@ void grabber_finalize(Grabber *self)
 		backing_deinit(&(self->backing));
 	}
 
+	free(self->target_context_list);
+	int r;
+	for (r = 0; r < QUANTIZER_COUNT; r++)
+	{
+		stroke_buffer_free(self->strokes[r]);
+	}
+	point_path_free(self->path);
+	free(self->speed_direction_sequence);
+	dispatcher_free(self->dispatcher);
+	if (self->reloading)
+	{
+		pthread_join(self->reload_thread, NULL);
+		configuration_unref(self->reloaded_conf);
+	}
+	configuration_unref(self->pending_conf);
+	configuration_unref(self->conf);
+	if (self->reload_fd >= 0)
+		close(self->reload_fd);
+	free(self->config_file);
+	window_cache_free(self->window_cache);
+	reactor_free(self->reactor);
+	if (self->control_fd >= 0)
+		close(self->control_fd);
+	if (self->launcher_fd >= 0)
+		close(self->launcher_fd);
 	XCloseDisplay(self->dpy);
 	return;
 }
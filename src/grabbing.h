@@ -18,10 +18,17 @@
 #ifndef MYGESTURES_GRABBING_H_
 #define MYGESTURES_GRABBING_H_
 
+#include <pthread.h>
 #include <X11/Xlib.h>
 #include "drawing/drawing-backing.h"
 #include "drawing/drawing-brush.h"
 #include "configuration.h"
+#include "window-cache.h"
+#include "dispatcher.h"
+#include "reactor.h"
+#include "stroke-buffer.h"
+#include "point-path.h"
+#include "quantizer.h"
 
 /* modifier keys */
 enum
@@ -67,14 +74,34 @@ typedef struct
 	int old_y;
 
 	int delta_min;
+	int delta_min_fixed;
+
+	/* units per meter of the device x axis, 0 if unknown */
+	int valuator_resolution;
 
 	int synaptics;
 
-	int rought_old_x;
-	int rought_old_y;
+	/* classify strokes from raw device deltas instead of the pointer */
+	int raw_motion;
+	double raw_x;
+	double raw_y;
+
+	/* newest motion not drawn yet and how many events it stands for */
+	int pending_x;
+	int pending_y;
+	int pending_count;
+
+	Time old_time;
 
-	char *fine_direction_sequence;
-	char *rought_direction_sequence;
+	/* strokes of the gesture for each quantizer resolution */
+	StrokeBuffer *strokes[QUANTIZER_COUNT];
+	int quantizer_enabled[QUANTIZER_COUNT];
+
+	/* fine sequence with '!' after each stroke drawn fast */
+	char *speed_direction_sequence;
+
+	/* points of the gesture, when strokes come from its simplified path */
+	PointPath *path;
 
 	backing_t backing;
 	brush_t brush;
@@ -83,18 +110,71 @@ typedef struct
 
 	struct brush_image_t *brush_image;
 
+	WindowCache *window_cache;
+	Dispatcher *dispatcher;
+
+	Reactor *reactor;
+	Configuration *conf;
+	int control_fd;
+
+	/* configuration reload: parsed on reload_thread, which signals
+	 * reload_fd when done, and swapped in between gestures */
+	char *config_file;
+	int reload_fd;
+	pthread_t reload_thread;
+	int reloading;
+	int reload_requested;
+	Configuration *reloaded_conf;
+	Configuration *pending_conf;
+
+	/* channel to the launcher helper, or -1 */
+	int launcher_fd;
+	ReactorSource *launcher_source;
+
+	/* actions in flight for all devices, or NULL to count them alone */
+	int *in_flight_counter;
+
+	/* continuous gesture followed during this movement, the stroke
+	 * buffer and stroke it was matched on, and its repeats */
+	Gesture *continuous_gesture;
+	int continuous_resolution;
+	int continuous_stroke;
+	int continuous_checked;
+	int continuous_steps;
+	int continuous_owed;
+	int continuous_fired;
+	int continuous_ticking;
+	ReactorTimer *continuous_timer;
+
+	/* window under the gesture and the contexts that apply to it */
+	Window target_window;
+	Context **target_context_list;
+	int target_context_count;
+	unsigned int target_generation;
+
 } Grabber;
 
 Grabber *grabber_new(char *device_name, int button);
 void grabber_loop(Grabber *self, Configuration *conf);
-void grabbing_start_movement(Grabber *self, int new_x, int new_y);
-void grabbing_update_movement(Grabber *self, int new_x, int new_y);
+void grabbing_start_movement(Grabber *self, int new_x, int new_y, Time time);
+void grabbing_update_movement(Grabber *self, int new_x, int new_y, Time time);
+void grabbing_set_target(Grabber *self, Window root, Window child,
+						 Configuration *conf);
 void grabbing_end_movement(Grabber *self, int new_x, int new_y,
 						   char *device_name, Configuration *conf);
 
+void grabber_stop(Grabber *self);
+void grabber_listen_control(Grabber *self, char *name);
 void grabber_finalize(Grabber *self);
 void grabber_print_devices(Grabber *self);
 void grabber_set_brush_color(Grabber *self, char *brush_color);
+void grabber_set_raw_motion(Grabber *self, int enable);
+void grabber_set_simplify_path(Grabber *self, int enable);
+void grabber_set_delta_min(Grabber *self, int delta_min);
+void grabber_set_launcher(Grabber *self, int launcher_fd);
+void grabber_set_in_flight_counter(Grabber *self, int *counter);
+void grabber_set_config_file(Grabber *self, char *filename);
+void grabber_reload(Grabber *self);
 void grabber_any_modifier(Grabber *self, int enable);
 void grabber_list_devices(Grabber *self);
 void grabber_follow_pointer(Grabber *self, int enable);
@@ -0,0 +1,164 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#include <stdlib.h>
+#include <strings.h>
+
+#include "keymap.h"
+
+Keymap *keymap_new(Display *dpy)
+{
+	Keymap *self = malloc(sizeof(Keymap));
+	bzero(self, sizeof(Keymap));
+
+	self->dpy = dpy;
+
+	return self;
+}
+
+void keymap_free(Keymap *self)
+{
+	if (!self)
+		return;
+
+	free(self->entries);
+	free(self);
+}
+
+void keymap_handle_event(Keymap *self, XEvent *ev)
+{
+	if (ev->type != MappingNotify)
+	{
+		return;
+	}
+
+	XRefreshKeyboardMapping(&ev->xmapping);
+
+	if (ev->xmapping.request == MappingKeyboard)
+	{
+		self->valid = 0;
+	}
+}
+
+/* entries in the order XKeysymToKeycode would find them */
+typedef struct keymap_slot_
+{
+	KeymapEntry entry;
+	int level;
+
+} KeymapSlot;
+
+static int keymap_compare_slots(const void *a, const void *b)
+{
+	const KeymapSlot *slot_a = a;
+	const KeymapSlot *slot_b = b;
+
+	if (slot_a->entry.keysym != slot_b->entry.keysym)
+		return slot_a->entry.keysym < slot_b->entry.keysym ? -1 : 1;
+
+	if (slot_a->level != slot_b->level)
+		return slot_a->level - slot_b->level;
+
+	return slot_a->entry.keycode - slot_b->entry.keycode;
+}
+
+static void keymap_load(Keymap *self)
+{
+	int min_keycode, max_keycode, keysyms_per_keycode;
+
+	XDisplayKeycodes(self->dpy, &min_keycode, &max_keycode);
+
+	int keycode_count = max_keycode - min_keycode + 1;
+	KeySym *keysyms = XGetKeyboardMapping(self->dpy, min_keycode,
+										  keycode_count, &keysyms_per_keycode);
+
+	free(self->entries);
+	self->entries = NULL;
+	self->count = 0;
+	self->valid = 1;
+
+	if (!keysyms)
+	{
+		return;
+	}
+
+	KeymapSlot *slots = malloc(sizeof(KeymapSlot) * keycode_count * keysyms_per_keycode);
+	int count = 0;
+
+	int i, level;
+	for (i = 0; i < keycode_count; i++)
+	{
+		for (level = 0; level < keysyms_per_keycode; level++)
+		{
+			KeySym keysym = keysyms[i * keysyms_per_keycode + level];
+
+			if (keysym != NoSymbol)
+			{
+				slots[count].entry.keysym = keysym;
+				slots[count].entry.keycode = min_keycode + i;
+				slots[count].level = level;
+				count++;
+			}
+		}
+	}
+
+	XFree(keysyms);
+
+	qsort(slots, count, sizeof(KeymapSlot), keymap_compare_slots);
+
+	/* keep the first keycode of each keysym */
+	self->entries = malloc(sizeof(KeymapEntry) * (count ? count : 1));
+
+	for (i = 0; i < count; i++)
+	{
+		if (self->count == 0 ||
+			self->entries[self->count - 1].keysym != slots[i].entry.keysym)
+		{
+			self->entries[self->count++] = slots[i].entry;
+		}
+	}
+
+	free(slots);
+}
+
+/**
+ * Keycode that produces the keysym, or 0 if there is none.
+ */
+KeyCode keymap_get_keycode(Keymap *self, KeySym keysym)
+{
+	if (!self->valid)
+	{
+		keymap_load(self);
+	}
+
+	int low = 0;
+	int high = self->count - 1;
+
+	while (low <= high)
+	{
+		int middle = (low + high) / 2;
+		KeySym found = self->entries[middle].keysym;
+
+		if (found == keysym)
+			return self->entries[middle].keycode;
+		else if (found < keysym)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+
+	return 0;
+}
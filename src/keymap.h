@@ -0,0 +1,51 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#ifndef MYGESTURES_KEYMAP_H_
+#define MYGESTURES_KEYMAP_H_
+
+#include <X11/Xlib.h>
+
+typedef struct keymap_entry_
+{
+	KeySym keysym;
+	KeyCode keycode;
+
+} KeymapEntry;
+
+/*
+ * Keysym to keycode table of a display, sorted by keysym. Built from the
+ * server keyboard mapping the first time a key is looked up, and again
+ * after a MappingNotify.
+ */
+typedef struct keymap_
+{
+	Display *dpy;
+
+	KeymapEntry *entries;
+	int count;
+	int valid;
+
+} Keymap;
+
+Keymap *keymap_new(Display *dpy);
+void keymap_free(Keymap *self);
+
+void keymap_handle_event(Keymap *self, XEvent *ev);
+
+KeyCode keymap_get_keycode(Keymap *self, KeySym keysym);
+
+#endif /* MYGESTURES_KEYMAP_H_ */
@@ -0,0 +1,409 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "launcher.h"
+#include "actions.h"
+#include "reactor.h"
+
+#ifndef LAUNCHER_MAX_REQUEST
+#define LAUNCHER_MAX_REQUEST 8192 /* bytes of a command and its arguments */
+#endif
+
+#ifndef LAUNCHER_MAX_ARGS
+#define LAUNCHER_MAX_ARGS 256
+#endif
+
+typedef struct launcher_channel_
+{
+	struct launcher_ *launcher;
+	int fd;
+	ReactorSource *source;
+
+} LauncherChannel;
+
+typedef struct launcher_child_
+{
+	int pid;
+	LauncherChannel *channel;
+
+	struct launcher_child_ *next;
+
+} LauncherChild;
+
+typedef struct launcher_
+{
+	Reactor *reactor;
+	ReactorSource *control_source;
+
+	int channel_count;
+	LauncherChild *children;
+
+} Launcher;
+
+static void launcher_report(LauncherChannel *channel, int pid, int status)
+{
+	LauncherExit report = {pid, status};
+
+	if (send(channel->fd, &report, sizeof(report), MSG_NOSIGNAL) < 0)
+	{
+		perror("Reporting to the grabber");
+	}
+}
+
+/*
+ * The helper is done once no grabber can reach it any more.
+ */
+static void launcher_check_done(Launcher *self)
+{
+	if (!self->control_source && self->channel_count == 0)
+	{
+		reactor_stop(self->reactor);
+	}
+}
+
+static void launcher_close_channel(LauncherChannel *channel)
+{
+	Launcher *self = channel->launcher;
+
+	LauncherChild *child;
+	for (child = self->children; child; child = child->next)
+	{
+		if (child->channel == channel)
+			child->channel = NULL;
+	}
+
+	reactor_remove(self->reactor, channel->source);
+	close(channel->fd);
+	free(channel);
+
+	self->channel_count--;
+	launcher_check_done(self);
+}
+
+/*
+ * A request is the command followed by its arguments, each terminated by
+ * a null byte. Without arguments the command is run by the shell.
+ */
+static void launcher_on_request(void *data, int fd, uint32_t events)
+{
+	LauncherChannel *channel = data;
+	Launcher *self = channel->launcher;
+	char request[LAUNCHER_MAX_REQUEST];
+
+	ssize_t len = recv(fd, request, sizeof(request), 0);
+
+	if (len == 0 || (len < 0 && errno != EAGAIN && errno != EINTR))
+	{
+		launcher_close_channel(channel);
+		return;
+	}
+
+	if (len <= 0 || request[len - 1] != '\0')
+	{
+		return;
+	}
+
+	char *argv[LAUNCHER_MAX_ARGS + 1];
+	int argc = 0;
+
+	char *command = request;
+	char *arg = command + strlen(command) + 1;
+
+	while (arg < request + len && argc < LAUNCHER_MAX_ARGS)
+	{
+		argv[argc++] = arg;
+		arg += strlen(arg) + 1;
+	}
+	argv[argc] = NULL;
+
+	int pid = action_execute(argc ? argv : NULL, command);
+
+	if (pid < 0)
+	{
+		launcher_report(channel, -1, 127);
+		return;
+	}
+
+	LauncherChild *child = malloc(sizeof(LauncherChild));
+	child->pid = pid;
+	child->channel = channel;
+	child->next = self->children;
+	self->children = child;
+}
+
+/*
+ * A grabber sent its end of a channel.
+ */
+static void launcher_on_control(void *data, int fd, uint32_t events)
+{
+	Launcher *self = data;
+
+	char byte;
+	struct iovec iov = {&byte, 1};
+
+	union
+	{
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+
+	struct msghdr msg;
+	bzero(&msg, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	ssize_t len = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+
+	if (len == 0 || (len < 0 && errno != EAGAIN && errno != EINTR))
+	{
+		/* every grabber is connected by now */
+		reactor_remove(self->reactor, self->control_source);
+		self->control_source = NULL;
+		close(fd);
+		launcher_check_done(self);
+		return;
+	}
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+
+	if (len < 0 || !cmsg || cmsg->cmsg_type != SCM_RIGHTS)
+	{
+		return;
+	}
+
+	LauncherChannel *channel = malloc(sizeof(LauncherChannel));
+	channel->launcher = self;
+	memcpy(&channel->fd, CMSG_DATA(cmsg), sizeof(int));
+	channel->source = reactor_add_fd(self->reactor, channel->fd, EPOLLIN,
+									 launcher_on_request, channel);
+	self->channel_count++;
+}
+
+static void launcher_on_signal(void *data, struct signalfd_siginfo *info)
+{
+	Launcher *self = data;
+
+	/* interrupts are for the grabbers; the helper leaves when they do */
+	if (info->ssi_signo != SIGCHLD)
+	{
+		return;
+	}
+
+	int pid, status;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+	{
+		LauncherChild **link = &self->children;
+
+		while (*link && (*link)->pid != pid)
+		{
+			link = &(*link)->next;
+		}
+
+		LauncherChild *child = *link;
+
+		if (!child)
+			continue;
+
+		if (child->channel)
+			launcher_report(child->channel, pid, status);
+
+		*link = child->next;
+		free(child);
+	}
+}
+
+static void launcher_main(int control_fd)
+{
+	Launcher self;
+	bzero(&self, sizeof(Launcher));
+
+	self.reactor = reactor_new();
+	self.control_source = reactor_add_fd(self.reactor, control_fd, EPOLLIN,
+										 launcher_on_control, &self);
+
+	static const int handled_signals[] = {SIGCHLD, SIGINT, SIGTERM};
+	reactor_add_signals(self.reactor, handled_signals, 3, launcher_on_signal,
+						&self);
+
+	reactor_run(self.reactor);
+
+	exit(0);
+}
+
+/*
+ * Fork the helper. Returns the control socket grabbers connect through,
+ * or -1 if the helper could not be started.
+ */
+int launcher_start()
+{
+	int fds[2];
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0)
+	{
+		perror("Starting the launcher");
+		return -1;
+	}
+
+	/* or what is buffered would be written twice */
+	fflush(stdout);
+
+	int pid = fork();
+
+	if (pid < 0)
+	{
+		perror("Starting the launcher");
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+
+	if (pid == 0)
+	{
+		close(fds[0]);
+		launcher_main(fds[1]);
+	}
+
+	close(fds[1]);
+	return fds[0];
+}
+
+/*
+ * Open a channel to the helper for this process. Returns its fd, or -1.
+ */
+int launcher_connect(int control_fd)
+{
+	int fds[2];
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0,
+				   fds) != 0)
+	{
+		perror("Connecting to the launcher");
+		return -1;
+	}
+
+	char byte = 0;
+	struct iovec iov = {&byte, 1};
+
+	union
+	{
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+	bzero(&control, sizeof(control));
+
+	struct msghdr msg;
+	bzero(&msg, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(cmsg), &fds[1], sizeof(int));
+
+	ssize_t sent = sendmsg(control_fd, &msg, MSG_NOSIGNAL);
+	close(fds[1]);
+
+	if (sent < 0)
+	{
+		perror("Connecting to the launcher");
+		close(fds[0]);
+		return -1;
+	}
+
+	return fds[0];
+}
+
+/*
+ * Ask the helper to launch a program. Returns 0 if the request was sent.
+ */
+int launcher_execute(int channel_fd, char **argv, char *command)
+{
+	assert(command);
+
+	char request[LAUNCHER_MAX_REQUEST];
+	size_t len = strlen(command) + 1;
+
+	if (len > sizeof(request))
+	{
+		fprintf(stderr, "Command too long for the launcher: '%s'\n", command);
+		return -1;
+	}
+	memcpy(request, command, len);
+
+	int i;
+	for (i = 0; argv && argv[i]; i++)
+	{
+		size_t arg_len = strlen(argv[i]) + 1;
+
+		if (len + arg_len > sizeof(request) || i == LAUNCHER_MAX_ARGS)
+		{
+			fprintf(stderr, "Command too long for the launcher: '%s'\n",
+					command);
+			return -1;
+		}
+		memcpy(request + len, argv[i], arg_len);
+		len += arg_len;
+	}
+
+	if (send(channel_fd, request, len, MSG_NOSIGNAL) < 0)
+	{
+		perror("Sending to the launcher");
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Read one exit report. Returns 1 if there was one, 0 if the helper is
+ * gone and -1 if there is nothing to read yet.
+ */
+int launcher_read_exit(int channel_fd, LauncherExit *report)
+{
+	ssize_t len = recv(channel_fd, report, sizeof(LauncherExit), 0);
+
+	if (len == sizeof(LauncherExit))
+	{
+		return 1;
+	}
+
+	if (len == 0 || (len < 0 && errno != EAGAIN && errno != EINTR))
+	{
+		return 0;
+	}
+
+	return -1;
+}
@@ -0,0 +1,46 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#ifndef MYGESTURES_LAUNCHER_H_
+#define MYGESTURES_LAUNCHER_H_
+
+/*
+ * A small helper process, forked at startup before the X connection and
+ * the configuration exist, that launches the programs of exec actions.
+ * Spawning from it costs the same however large the grabber grows, and
+ * the grabber never becomes the parent of a misbehaving program.
+ *
+ * Each grabber passes one end of its own socket pair to the helper over
+ * the control socket. Exec requests go through that channel and the
+ * helper reports back there when each program exits.
+ */
+
+/* a program ended, or could not be launched when pid is -1 */
+typedef struct launcher_exit_
+{
+	int pid;
+	int status;
+
+} LauncherExit;
+
+int launcher_start();
+int launcher_connect(int control_fd);
+
+int launcher_execute(int channel_fd, char **argv, char *command);
+int launcher_read_exit(int channel_fd, LauncherExit *report);
+
+#endif /* MYGESTURES_LAUNCHER_H_ */
@@ -8,6 +8,7 @@
 #include <getopt.h>
 #include <unistd.h>
 #include <signal.h>
+#include <X11/Xlib.h>
 
 #include "assert.h"
 
@@ -36,13 +37,16 @@ static void process_arguments(Mygestures *self, int argc, char *const *argv)
 		{"help", no_argument, 0, 'h'},
 		{"visual", no_argument, 0, 'v'},
 		{"multitouch", no_argument, 0, 'm'},
+		{"raw-motion", no_argument, 0, 'r'},
+		{"simplify", no_argument, 0, 's'},
+		{"launcher", no_argument, 0, 'x'},
 		{0, 0, 0, 0}};
 
 	/* read params */
 
 	while (1)
 	{
-		opt = getopt_long(argc, argv, "b:c:d:vhlm", opts, NULL);
+		opt = getopt_long(argc, argv, "b:c:d:vhlmrsx", opts, NULL);
 		if (opt == -1)
 			break;
 
@@ -61,6 +65,18 @@ static void process_arguments(Mygestures *self, int argc, char *const *argv)
 			self->multitouch = 1;
 			break;
 
+		case 'r':
+			self->raw_motion = 1;
+			break;
+
+		case 's':
+			self->simplify_path = 1;
+			break;
+
+		case 'x':
+			self->use_launcher = 1;
+			break;
+
 		case 'v':
 			if (!(self->brush_color))
 			{
@@ -133,9 +149,12 @@ static void char_replace(char *str, char oldChar, char newChar)
 		*strPtr++ = newChar;
 }
 
-void alloc_shared_memory(char *device_name, int button)
+/*
+ * Name shared by all instances grabbing the same device and button.
+ */
+char *get_instance_identifier(char *device_name, int button)
 {
-
+	char *identifier = NULL;
 	char *sanitized_device_name = strdup(device_name);
 
 	if (sanitized_device_name)
@@ -147,9 +166,17 @@ void alloc_shared_memory(char *device_name, int button)
 		sanitized_device_name = "";
 	}
 
-	int bytes = asprintf(&shm_identifier, "/mygestures_uid_%d_dev_%s_button_%d", getuid(),
+	int bytes = asprintf(&identifier, "/mygestures_uid_%d_dev_%s_button_%d", getuid(),
 						 sanitized_device_name, button);
 
+	return identifier;
+}
+
+void alloc_shared_memory(char *device_name, int button)
+{
+
+	shm_identifier = get_instance_identifier(device_name, button);
+
 	int shared_seg_size = sizeof(struct shm_message);
 	int shmfd = shm_open(shm_identifier, O_CREAT | O_RDWR, 0600);
 
@@ -190,6 +217,10 @@ static void release_shared_memory()
 	}
 }
 
+/*
+ * Called from the grabber event loop when SIGINT arrives, not from a signal
+ * handler.
+ */
 void on_interrupt(int a)
 {
 
@@ -203,20 +234,28 @@ void on_interrupt(int a)
 		printf("\nReceived the interrupt signal.\n");
 		release_shared_memory();
 	}
-
-	exit(0);
 }
 
+/*
+ * Called from the grabber event loop when SIGTERM arrives.
+ */
 void on_kill(int a)
 {
-	//release_shared_memory();
 
-	exit(0);
+	/* shared memory belongs to the instance that asked us to exit */
+	if (!message->kill)
+	{
+		printf("\nReceived the terminate signal.\n");
+		release_shared_memory();
+	}
 }
 
 int main(int argc, char *const *argv)
 {
 
+	/* actions run on a thread with its own connection */
+	XInitThreads();
+
 	Mygestures *self = mygestures_new();
 
 	process_arguments(self, argc, argv);
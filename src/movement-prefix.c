@@ -0,0 +1,237 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "movement-prefix.h"
+
+/*
+ * Each parse function returns the prefix expression of what it parsed,
+ * a group that also matches the empty sequence, and moves *pos past it.
+ * The rules:
+ *
+ *    prefix(a)     = (a)?
+ *    prefix(r1|r2) = (prefix(r1)|prefix(r2))
+ *    prefix(r1 r2) = (prefix(r1)|r1 prefix(r2))
+ *    prefix(r?)    = prefix(r)
+ *    prefix(r*)    = (r)*prefix(r), and the same for r+ and r{m,n}
+ */
+
+static char *prefix_alternation(const char **pos);
+
+static char *join(const char *a, size_t a_len, const char *b, size_t b_len,
+				  const char *c)
+{
+	size_t c_len = strlen(c);
+	char *joined = malloc(a_len + b_len + c_len + 1);
+
+	memcpy(joined, a, a_len);
+	memcpy(joined + a_len, b, b_len);
+	memcpy(joined + a_len + b_len, c, c_len + 1);
+
+	return joined;
+}
+
+/* wrap the text between start and end as an optional group */
+static char *prefix_optional(const char *start, const char *end)
+{
+	return join("(", 1, start, end - start, ")?");
+}
+
+static char *prefix_atom(const char **pos)
+{
+	const char *start = *pos;
+	const char *p = start;
+
+	switch (*p)
+	{
+	case '(':
+	{
+		*pos = p + 1;
+		char *inner = prefix_alternation(pos);
+
+		if (!inner || **pos != ')')
+		{
+			free(inner);
+			return NULL;
+		}
+		(*pos)++;
+		return inner;
+	}
+	case '[':
+		p++;
+		if (*p == '^')
+			p++;
+		/* a ']' right after the opening is part of the class */
+		if (*p == ']')
+			p++;
+		while (*p && *p != ']')
+			p++;
+		if (!*p)
+			return NULL;
+		*pos = p + 1;
+		return prefix_optional(start, *pos);
+	case '\\':
+		if (!p[1])
+			return NULL;
+		*pos = p + 2;
+		return prefix_optional(start, *pos);
+	case '\0':
+	case ')':
+	case '|':
+	case '?':
+	case '*':
+	case '+':
+	case '{':
+	case '^':
+	case '$':
+		return NULL;
+	default:
+		*pos = p + 1;
+		return prefix_optional(start, *pos);
+	}
+}
+
+static char *prefix_repetition(const char **pos)
+{
+	const char *start = *pos;
+	char *prefix = prefix_atom(pos);
+
+	while (prefix && **pos && strchr("?*+{", **pos))
+	{
+		const char *repeated_end = *pos;
+
+		if (**pos == '{')
+		{
+			const char *close = strchr(*pos, '}');
+
+			if (!close)
+			{
+				free(prefix);
+				return NULL;
+			}
+			*pos = close;
+		}
+
+		/* any count may be cut short, so bounds do not matter */
+		if (**pos != '?')
+		{
+			char *group = join("(", 1, start, repeated_end - start, ")*");
+			char *repeated = join(group, strlen(group), prefix,
+								  strlen(prefix), "");
+			free(group);
+			free(prefix);
+			prefix = repeated;
+		}
+
+		(*pos)++;
+	}
+
+	return prefix;
+}
+
+static char *prefix_concatenation(const char **pos)
+{
+	const char *start = *pos;
+	char *prefix = NULL;
+
+	while (**pos && **pos != '|' && **pos != ')')
+	{
+		const char *item_start = *pos;
+		char *item = prefix_repetition(pos);
+
+		if (!item)
+		{
+			free(prefix);
+			return NULL;
+		}
+
+		/* what came before this item, drawn whole, then a prefix of it */
+		char *branch = join(start, item_start - start, item, strlen(item),
+							"");
+		free(item);
+
+		if (prefix)
+		{
+			char *both = join(prefix, strlen(prefix), "|", 1, branch);
+			free(prefix);
+			free(branch);
+			prefix = both;
+		}
+		else
+		{
+			prefix = branch;
+		}
+	}
+
+	if (!prefix)
+	{
+		return NULL;
+	}
+
+	char *group = join("(", 1, prefix, strlen(prefix), ")");
+	free(prefix);
+	return group;
+}
+
+static char *prefix_alternation(const char **pos)
+{
+	char *prefix = prefix_concatenation(pos);
+
+	while (prefix && **pos == '|')
+	{
+		(*pos)++;
+		char *branch = prefix_concatenation(pos);
+
+		if (!branch)
+		{
+			free(prefix);
+			return NULL;
+		}
+
+		char *both = join(prefix, strlen(prefix), "|", 1, branch);
+		free(prefix);
+		free(branch);
+		prefix = both;
+	}
+
+	if (!prefix)
+	{
+		return NULL;
+	}
+
+	char *group = join("(", 1, prefix, strlen(prefix), ")");
+	free(prefix);
+	return group;
+}
+
+char *movement_prefix_expression(const char *expression)
+{
+	const char *pos = expression;
+	char *prefix = prefix_alternation(&pos);
+
+	if (!prefix || *pos)
+	{
+		free(prefix);
+		return NULL;
+	}
+
+	char *anchored = join("^", 1, prefix, strlen(prefix), "$");
+	free(prefix);
+	return anchored;
+}
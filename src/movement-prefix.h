@@ -0,0 +1,33 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#ifndef MYGESTURES_MOVEMENT_PREFIX_H_
+#define MYGESTURES_MOVEMENT_PREFIX_H_
+
+/*
+ * Rewrites a movement expression into one matching every prefix of the
+ * sequences it matches, the empty one included. A continuous gesture uses
+ * it to tell whether another movement could still be drawn from where the
+ * gesture is.
+ *
+ * Handles what movements are written with: groups, '|', '?', '*', '+',
+ * '{m,n}', bracket classes, '.' and escapes. Returns a newly allocated
+ * expression, anchored at both ends, or NULL for anything else.
+ */
+char *movement_prefix_expression(const char *expression);
+
+#endif /* MYGESTURES_MOVEMENT_PREFIX_H_ */
@@ -0,0 +1,79 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#ifndef MYGESTURES_PLUGIN_H_
+#define MYGESTURES_PLUGIN_H_
+
+/*
+ * Interface for action plugins. A plugin is a shared object listed in the
+ * configuration with
+ *
+ *     <plugin file="/path/to/plugin.so" />
+ *
+ * It exports mygestures_plugin_init, which registers named actions. Those
+ * names are then used like the built-in ones:
+ *
+ *     <do action="my-action" value="anything" />
+ *
+ * The plugin is initialized once and stays loaded until mygestures exits.
+ * When the configuration is reloaded, the actions it registered are kept.
+ *
+ * Actions run on a dispatcher thread. The Display they get belongs to that
+ * thread and may be used freely from the action, but must not be kept.
+ */
+
+#include <X11/Xlib.h>
+
+#define MYGESTURES_PLUGIN_ABI_VERSION 1
+
+/* the gesture that triggered an action */
+typedef struct mygestures_gesture_
+{
+	const char *name;
+	const char *movement;
+	const char *context;
+
+} MygesturesGesture;
+
+typedef void (*MygesturesActionFunction)(Display *dpy, Window window,
+										 const MygesturesGesture *gesture,
+										 const char *value, void *user_data);
+
+typedef struct mygestures_plugin_api_
+{
+	/* the version mygestures was built with */
+	int abi_version;
+
+	void (*register_action)(struct mygestures_plugin_api_ *api,
+							const char *name,
+							MygesturesActionFunction function,
+							void *user_data);
+
+	/* private to mygestures */
+	void *registry;
+
+} MygesturesPluginApi;
+
+/*
+ * Implemented by the plugin. Returns 0 on success; the plugin is unloaded
+ * otherwise, e.g. when abi_version is not one it supports.
+ */
+int mygestures_plugin_init(MygesturesPluginApi *api);
+
+typedef int (*MygesturesPluginInit)(MygesturesPluginApi *api);
+
+#endif /* MYGESTURES_PLUGIN_H_ */
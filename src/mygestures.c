@@ -24,6 +24,7 @@
 #include <signal.h>
 
 #include <sys/types.h>
+#include <sys/mman.h>
 
 #include "assert.h"
 #include "string.h"
@@ -35,6 +36,7 @@
 #include "grabbing.h"
 #include "configuration.h"
 #include "configuration_parser.h"
+#include "launcher.h"
 
 uint MAX_GRABBED_DEVICES = 10;
 
@@ -59,6 +61,12 @@ static void mygestures_usage(Mygestures *self)
 	printf(" -c, --color                : Brush color.\n");
 	printf("                              Default: blue\n");
 	printf("                              Options: yellow, white, red, green, purple, blue\n");
+	printf(" -r, --raw-motion           : Recognize strokes from raw device motion,\n");
+	printf("                              ignoring pointer acceleration and screen edges.\n");
+	printf(" -s, --simplify             : Recognize strokes from the simplified shape of\n");
+	printf("                              the whole gesture, when the button is released.\n");
+	printf(" -x, --launcher             : Launch programs from a helper process started\n");
+	printf("                              before the configuration is loaded.\n");
 	printf(" -h, --help                 : Help\n");
 	printf(" -m, --multitouch           : Multitouch mode on some synaptic touchpads.\n");
 	printf("                              It depends on this patched synaptics driver to work:\n");
@@ -73,6 +81,7 @@ Mygestures *mygestures_new()
 
 	self->device_list = malloc(sizeof(uint) * MAX_GRABBED_DEVICES);
 	self->gestures_configuration = configuration_new();
+	self->launcher_fd = -1;
 
 	return self;
 }
@@ -91,6 +100,45 @@ static void mygestures_load_configuration(Mygestures *self)
 	}
 }
 
+static void mygestures_on_signal(void *data, struct signalfd_siginfo *info)
+{
+	Grabber *grabber = data;
+
+	if (info->ssi_signo == SIGHUP)
+	{
+		grabber_reload(grabber);
+		return;
+	}
+
+	if (info->ssi_signo == SIGINT)
+	{
+		on_interrupt(info->ssi_signo);
+	}
+	else
+	{
+		on_kill(info->ssi_signo);
+	}
+
+	grabber_stop(grabber);
+}
+
+static void mygestures_on_config_changed(void *data, const char *filename)
+{
+	Grabber *grabber = data;
+
+	printf("Configuration file '%s' changed.\n", filename);
+	grabber_reload(grabber);
+}
+
+static char *mygestures_get_config_filename(Mygestures *self)
+{
+	if (self->custom_config_file)
+	{
+		return strdup(self->custom_config_file);
+	}
+	return configuration_get_default_filename();
+}
+
 static void mygestures_grab_device(Mygestures *self, char *device_name)
 {
 
@@ -108,11 +156,33 @@ static void mygestures_grab_device(Mygestures *self, char *device_name)
 		Grabber *grabber = grabber_new(device_name, self->trigger_button);
 
 		grabber_set_brush_color(grabber, self->brush_color);
+		grabber_set_raw_motion(grabber, self->raw_motion);
+		grabber_set_simplify_path(grabber, self->simplify_path);
+		grabber_set_in_flight_counter(grabber, self->in_flight_counter);
+
+		if (self->launcher_fd >= 0)
+		{
+			grabber_set_launcher(grabber, launcher_connect(self->launcher_fd));
+			close(self->launcher_fd);
+		}
+
+		DeviceSettings *settings = configuration_find_device(
+			self->gestures_configuration, device_name);
+		if (settings)
+		{
+			grabber_set_delta_min(grabber, settings->delta_min);
+		}
 
 		send_kill_message(device_name);
 
-		signal(SIGINT, on_interrupt);
-		signal(SIGKILL, on_kill);
+		static const int handled_signals[] = {SIGINT, SIGTERM, SIGHUP};
+		reactor_add_signals(grabber->reactor, handled_signals, 3,
+							mygestures_on_signal, grabber);
+
+		char *identifier = get_instance_identifier(device_name,
+												   self->trigger_button);
+		grabber_listen_control(grabber, identifier);
+		free(identifier);
 
 		if (self->list_devices_flag)
 		{
@@ -120,8 +190,19 @@ static void mygestures_grab_device(Mygestures *self, char *device_name)
 		}
 		else
 		{
+			char *config_file = mygestures_get_config_filename(self);
+			grabber_set_config_file(grabber, config_file);
+			reactor_watch_file(grabber->reactor, config_file,
+							   mygestures_on_config_changed, grabber);
+			free(config_file);
+
 			grabber_loop(grabber, self->gestures_configuration);
 		}
+
+		grabber_finalize(grabber);
+
+		/* a grabber must never go on to grab the next device */
+		exit(0);
 	}
 }
 
@@ -136,6 +217,24 @@ void mygestures_run(Mygestures *self)
 		exit(0);
 	}
 
+	/*
+	 * The helper is forked while this process is still small.
+	 */
+	if (self->use_launcher && !self->list_devices_flag)
+	{
+		self->launcher_fd = launcher_start();
+	}
+
+	/*
+	 * One limit of actions in flight for all the devices grabbed.
+	 */
+	void *counter = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE,
+						 MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (counter != MAP_FAILED)
+	{
+		self->in_flight_counter = counter;
+	}
+
 	/*
 	 * Will not load configuration if it is only listing the devices.
 	 */
@@ -9,7 +9,16 @@ typedef struct mygestures_
 	int help_flag;
 	int trigger_button;
 	int multitouch;
+	int raw_motion;
+	int simplify_path;
 	int list_devices_flag;
+	int use_launcher;
+
+	/* control socket of the launcher helper, or -1 */
+	int launcher_fd;
+
+	/* actions in flight for all devices, shared with the grabber processes */
+	int *in_flight_counter;
 
 	char *custom_config_file;
 
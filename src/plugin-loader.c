@@ -0,0 +1,209 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "plugin-loader.h"
+#include "mygestures-plugin.h"
+#include "configuration_parser.h"
+#include "actions.h"
+
+/*
+ * A plugin is loaded and initialized once per process. Reloading the
+ * configuration hands the same registered actions to the new one, so the
+ * plugin's state is neither created twice nor lost.
+ */
+typedef struct loaded_plugin_
+{
+	void *handle;
+
+	PluginAction *action_list;
+	int action_count;
+
+	struct loaded_plugin_ *next;
+
+} LoadedPlugin;
+
+static LoadedPlugin *loaded_plugins;
+
+/* configurations are loaded on the reload thread too */
+static pthread_mutex_t loaded_plugins_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static PluginAction *plugin_find_action(LoadedPlugin *plugin,
+										const char *name)
+{
+	int i;
+	for (i = 0; i < plugin->action_count; i++)
+	{
+		if (strcasecmp(plugin->action_list[i].name, name) == 0)
+			return &plugin->action_list[i];
+	}
+
+	return NULL;
+}
+
+static void plugin_register_action(MygesturesPluginApi *api, const char *name,
+								   MygesturesActionFunction function,
+								   void *user_data)
+{
+	LoadedPlugin *plugin = api->registry;
+
+	if (!name || !function)
+	{
+		return;
+	}
+
+	if (plugin_find_action(plugin, name))
+	{
+		printf("Plugin action '%s' is already registered.\n", name);
+		return;
+	}
+
+	if (plugin->action_count == MAX_PLUGIN_ACTIONS)
+	{
+		printf("More than %d plugin actions, ignoring '%s'.\n",
+			   MAX_PLUGIN_ACTIONS, name);
+		return;
+	}
+
+	if (configuration_find_builtin_action((char *)name) != ACTION_NULL)
+	{
+		printf("Plugin action '%s' is hidden by the built-in action.\n",
+			   name);
+	}
+
+	PluginAction *action = &plugin->action_list[plugin->action_count++];
+	action->name = strdup(name);
+	action->function = function;
+	action->user_data = user_data;
+}
+
+/*
+ * Open and initialize a plugin, or find it if this process already did.
+ * Called with the lock held.
+ */
+static LoadedPlugin *plugin_open(char *filename)
+{
+	void *handle = dlopen(filename, RTLD_NOW | RTLD_LOCAL);
+
+	if (!handle)
+	{
+		printf("Cannot load plugin: %s\n", dlerror());
+		return NULL;
+	}
+
+	LoadedPlugin *plugin;
+	for (plugin = loaded_plugins; plugin; plugin = plugin->next)
+	{
+		if (plugin->handle == handle)
+		{
+			/* already initialized, maybe under another path */
+			dlclose(handle);
+			return plugin;
+		}
+	}
+
+	MygesturesPluginInit init = (MygesturesPluginInit)dlsym(handle,
+															"mygestures_plugin_init");
+
+	if (!init)
+	{
+		printf("Plugin '%s' has no mygestures_plugin_init.\n", filename);
+		dlclose(handle);
+		return NULL;
+	}
+
+	plugin = malloc(sizeof(LoadedPlugin));
+	bzero(plugin, sizeof(LoadedPlugin));
+	plugin->handle = handle;
+	plugin->action_list = malloc(sizeof(PluginAction) * MAX_PLUGIN_ACTIONS);
+
+	MygesturesPluginApi api;
+	api.abi_version = MYGESTURES_PLUGIN_ABI_VERSION;
+	api.register_action = plugin_register_action;
+	api.registry = plugin;
+
+	if (init(&api) != 0)
+	{
+		printf("Plugin '%s' failed to initialize.\n", filename);
+
+		/* its actions would point into the unloaded object */
+		int i;
+		for (i = 0; i < plugin->action_count; i++)
+		{
+			free(plugin->action_list[i].name);
+		}
+		free(plugin->action_list);
+		free(plugin);
+
+		dlclose(handle);
+		return NULL;
+	}
+
+	plugin->next = loaded_plugins;
+	loaded_plugins = plugin;
+
+	return plugin;
+}
+
+/*
+ * Load a plugin and make its actions available in conf. Returns 0 on
+ * success.
+ */
+int plugin_load(Configuration *conf, char *filename)
+{
+	assert(conf);
+	assert(filename);
+
+	pthread_mutex_lock(&loaded_plugins_lock);
+
+	LoadedPlugin *plugin = plugin_open(filename);
+
+	int i;
+	for (i = 0; plugin && i < plugin->action_count; i++)
+	{
+		PluginAction *action = &plugin->action_list[i];
+
+		if (configuration_find_plugin_action(conf, action->name))
+		{
+			printf("Plugin action '%s' is already registered.\n",
+				   action->name);
+			continue;
+		}
+
+		if (conf->plugin_action_count == MAX_PLUGIN_ACTIONS)
+		{
+			printf("More than %d plugin actions, ignoring '%s'.\n",
+				   MAX_PLUGIN_ACTIONS, action->name);
+			continue;
+		}
+
+		configuration_create_plugin_action(conf, strdup(action->name),
+										   action->function,
+										   action->user_data);
+	}
+
+	pthread_mutex_unlock(&loaded_plugins_lock);
+
+	return plugin ? 0 : -1;
+}
@@ -0,0 +1,149 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#include <stdlib.h>
+#include <strings.h>
+#include <math.h>
+
+#include "point-path.h"
+
+PointPath *point_path_new(int capacity)
+{
+	PointPath *self = malloc(sizeof(PointPath));
+	bzero(self, sizeof(PointPath));
+
+	self->capacity = capacity;
+	self->points = malloc(sizeof(PathPoint) * capacity);
+	self->keep = malloc(capacity);
+	self->stack = malloc(sizeof(int) * 2 * capacity);
+
+	return self;
+}
+
+void point_path_free(PointPath *self)
+{
+	if (!self)
+		return;
+
+	free(self->points);
+	free(self->keep);
+	free(self->stack);
+	free(self);
+}
+
+void point_path_clear(PointPath *self)
+{
+	self->count = 0;
+}
+
+void point_path_add(PointPath *self, int x, int y, Time time)
+{
+	if (self->count == self->capacity)
+	{
+		int i;
+		for (i = 0; i < self->count / 2; i++)
+		{
+			self->points[i] = self->points[2 * i];
+		}
+		self->count = self->count / 2;
+	}
+
+	PathPoint *point = &self->points[self->count++];
+	point->x = x;
+	point->y = y;
+	point->time = time;
+}
+
+/* distance from p to the line through a and b */
+static double point_line_distance(PathPoint *p, PathPoint *a, PathPoint *b)
+{
+	double dx = b->x - a->x;
+	double dy = b->y - a->y;
+	double length = hypot(dx, dy);
+
+	if (length == 0)
+	{
+		return hypot(p->x - a->x, p->y - a->y);
+	}
+
+	return fabs(dy * (p->x - a->x) - dx * (p->y - a->y)) / length;
+}
+
+/*
+ * Douglas-Peucker: drop every point closer than epsilon to the polyline
+ * through the points kept. Iterative, using the preallocated stack.
+ * Returns the number of points left.
+ */
+int point_path_simplify(PointPath *self, double epsilon)
+{
+	if (self->count < 3)
+	{
+		return self->count;
+	}
+
+	bzero(self->keep, self->count);
+	self->keep[0] = 1;
+	self->keep[self->count - 1] = 1;
+
+	int top = 0;
+	self->stack[top++] = 0;
+	self->stack[top++] = self->count - 1;
+
+	while (top > 0)
+	{
+		int last = self->stack[--top];
+		int first = self->stack[--top];
+
+		double max_distance = 0;
+		int farthest = -1;
+
+		int i;
+		for (i = first + 1; i < last; i++)
+		{
+			double distance = point_line_distance(&self->points[i],
+												  &self->points[first],
+												  &self->points[last]);
+			if (distance > max_distance)
+			{
+				max_distance = distance;
+				farthest = i;
+			}
+		}
+
+		if (farthest >= 0 && max_distance > epsilon)
+		{
+			self->keep[farthest] = 1;
+
+			self->stack[top++] = first;
+			self->stack[top++] = farthest;
+			self->stack[top++] = farthest;
+			self->stack[top++] = last;
+		}
+	}
+
+	int count = 0;
+	int i;
+	for (i = 0; i < self->count; i++)
+	{
+		if (self->keep[i])
+		{
+			self->points[count++] = self->points[i];
+		}
+	}
+	self->count = count;
+
+	return count;
+}
@@ -0,0 +1,55 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#ifndef MYGESTURES_POINT_PATH_H_
+#define MYGESTURES_POINT_PATH_H_
+
+#include <X11/Xlib.h>
+
+typedef struct path_point_
+{
+	int x;
+	int y;
+	Time time;
+
+} PathPoint;
+
+/*
+ * The points of a gesture, kept in buffers allocated once. When full,
+ * every other point is dropped, so a long gesture keeps its shape at a
+ * lower resolution.
+ */
+typedef struct point_path_
+{
+	PathPoint *points;
+	int count;
+	int capacity;
+
+	/* work space of point_path_simplify */
+	unsigned char *keep;
+	int *stack;
+
+} PointPath;
+
+PointPath *point_path_new(int capacity);
+void point_path_free(PointPath *self);
+
+void point_path_clear(PointPath *self);
+void point_path_add(PointPath *self, int x, int y, Time time);
+
+int point_path_simplify(PointPath *self, double epsilon);
+
+#endif /* MYGESTURES_POINT_PATH_H_ */
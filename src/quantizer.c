@@ -0,0 +1,193 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "quantizer.h"
+
+#define BINS_PER_OCTANT (QUANTIZER_BINS / 8)
+
+/*
+ * tan(k * 3.75 degrees) for k = 1..11, as 16.16 fixed point: the bin
+ * boundaries between 0 and 45 degrees.
+ */
+static const int32_t slope_table[BINS_PER_OCTANT - 1] = {
+	4295, 8628, 13036, 17560, 22246, 27146,
+	32319, 37837, 43790, 50288, 57474};
+
+QuantizerResolution quantizer_resolutions[QUANTIZER_COUNT] = {
+	{4, "RDLU"},
+	{8, "R3D1L7U9"},
+	{12, "RabDcdLefUgh"},
+	{16, "Ri3jDk1lLm7nUo9p"}};
+
+/*
+ * Sector i is centered at i * 360 / sectors degrees. In 8 sectors the
+ * axes are narrower than the diagonals, close to the 3:1 slope the
+ * classifier always used.
+ */
+static int get_half_width(int resolution, int sector)
+{
+	int sectors = quantizer_resolutions[resolution].sectors;
+
+	if (resolution == QUANTIZER_8)
+	{
+		return (sector % 2 == 0) ? 5 : 7;
+	}
+
+	return QUANTIZER_BINS / sectors / 2;
+}
+
+void quantizer_init()
+{
+	int r;
+	for (r = 0; r < QUANTIZER_COUNT; r++)
+	{
+		QuantizerResolution *res = &quantizer_resolutions[r];
+
+		int i;
+		for (i = 0; i < res->sectors; i++)
+		{
+			int center = i * QUANTIZER_BINS / res->sectors;
+			int half = get_half_width(r, i);
+
+			res->first_bin[i] = (center - half + QUANTIZER_BINS) % QUANTIZER_BINS;
+			res->bin_count[i] = 2 * half;
+
+			int b;
+			for (b = 0; b < res->bin_count[i]; b++)
+			{
+				res->direction[(res->first_bin[i] + b) % QUANTIZER_BINS] = res->symbols[i];
+			}
+		}
+	}
+}
+
+/* bin of an angle between 0 and 45 degrees, given its tangent a / b */
+static int get_octant_bin(int a, int b)
+{
+	int64_t scaled = (int64_t)a << 16;
+
+	int bin = 0;
+	while (bin < BINS_PER_OCTANT - 1 && scaled >= (int64_t)b * slope_table[bin])
+	{
+		bin++;
+	}
+
+	return bin;
+}
+
+/**
+ * Bin of the angle of a movement, or -1 if there was no movement.
+ */
+int quantizer_get_bin(int x_delta, int y_delta)
+{
+	if (x_delta == 0 && y_delta == 0)
+	{
+		return -1;
+	}
+
+	int ax = abs(x_delta);
+	int ay = abs(y_delta);
+
+	/* angle between 0 and 90 degrees */
+	int bin;
+	if (ay <= ax)
+	{
+		bin = get_octant_bin(ay, ax);
+	}
+	else
+	{
+		bin = 2 * BINS_PER_OCTANT - 1 - get_octant_bin(ax, ay);
+	}
+
+	if (x_delta >= 0 && y_delta >= 0)
+	{
+		return bin;
+	}
+	else if (x_delta < 0 && y_delta >= 0)
+	{
+		return QUANTIZER_BINS / 2 - 1 - bin;
+	}
+	else if (x_delta < 0)
+	{
+		return QUANTIZER_BINS / 2 + bin;
+	}
+	else
+	{
+		return QUANTIZER_BINS - 1 - bin;
+	}
+}
+
+static int get_sector(QuantizerResolution *res, char symbol)
+{
+	const char *found = strchr(res->symbols, symbol);
+
+	return (symbol && found) ? found - res->symbols : -1;
+}
+
+/**
+ * Symbol of a bin. While the bin is within the sector of the current
+ * direction widened by up to hysteresis bins on each side (at most a
+ * quarter of the sector), the current direction is kept.
+ */
+char quantizer_get_direction(int resolution, int bin, char current,
+							 int hysteresis)
+{
+	QuantizerResolution *res = &quantizer_resolutions[resolution];
+
+	int sector = get_sector(res, current);
+
+	if (sector >= 0)
+	{
+		int margin = res->bin_count[sector] / 4;
+		if (margin > hysteresis)
+		{
+			margin = hysteresis;
+		}
+
+		int offset = (bin - res->first_bin[sector] + margin + QUANTIZER_BINS) % QUANTIZER_BINS;
+
+		if (offset < res->bin_count[sector] + 2 * margin)
+		{
+			return current;
+		}
+	}
+
+	return res->direction[bin];
+}
+
+/**
+ * Whether a movement expression has symbols only this resolution has.
+ */
+int quantizer_uses_alphabet(int resolution, const char *expression)
+{
+	QuantizerResolution *res = &quantizer_resolutions[resolution];
+	QuantizerResolution *common = &quantizer_resolutions[QUANTIZER_8];
+
+	const char *c;
+	for (c = expression; *c; c++)
+	{
+		if (get_sector(res, *c) >= 0 && get_sector(common, *c) < 0)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
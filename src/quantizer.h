@@ -0,0 +1,74 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#ifndef MYGESTURES_QUANTIZER_H_
+#define MYGESTURES_QUANTIZER_H_
+
+/*
+ * Turns a movement into a direction symbol. The angle of the movement is
+ * first reduced to one of QUANTIZER_BINS bins of 3.75 degrees, using only
+ * integer math, and each resolution then maps bins to its own symbols
+ * with a lookup table. So a movement is classified for all resolutions
+ * at the cost of one.
+ *
+ * Angles grow clockwise on screen, from 0 (right) to 90 (down).
+ *
+ *    4 sectors: L R U D
+ *    8 sectors: L R U D and the diagonals 7 9 1 3
+ *   12 sectors: L R U D and two directions between each pair of them,
+ *               a b (right to down), c d, e f, g h (up to right)
+ *   16 sectors: L R U D 7 9 1 3 and one direction between each pair of
+ *               them, i (right to 3) j k l m n o p (9 to right)
+ */
+
+#define QUANTIZER_BINS 96
+#define QUANTIZER_MAX_SECTORS 16
+
+enum
+{
+	QUANTIZER_4,
+	QUANTIZER_8,
+	QUANTIZER_12,
+	QUANTIZER_16,
+	QUANTIZER_COUNT
+};
+
+typedef struct quantizer_resolution_
+{
+	int sectors;
+	const char *symbols;
+
+	/* symbol of each bin */
+	char direction[QUANTIZER_BINS];
+
+	/* bins covered by each sector */
+	int first_bin[QUANTIZER_MAX_SECTORS];
+	int bin_count[QUANTIZER_MAX_SECTORS];
+
+} QuantizerResolution;
+
+extern QuantizerResolution quantizer_resolutions[QUANTIZER_COUNT];
+
+void quantizer_init();
+
+int quantizer_get_bin(int x_delta, int y_delta);
+
+char quantizer_get_direction(int resolution, int bin, char current,
+							 int hysteresis);
+
+int quantizer_uses_alphabet(int resolution, const char *expression);
+
+#endif /* MYGESTURES_QUANTIZER_H_ */
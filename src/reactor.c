@@ -0,0 +1,397 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#define _GNU_SOURCE /* needed by strdup/basename */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <libgen.h>
+#include <assert.h>
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#include <sys/inotify.h>
+
+#include "reactor.h"
+
+#define REACTOR_MAX_EVENTS 16
+
+Reactor *reactor_new()
+{
+	Reactor *self = malloc(sizeof(Reactor));
+	bzero(self, sizeof(Reactor));
+
+	self->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (self->epoll_fd < 0)
+	{
+		perror("In epoll_create1()");
+		exit(1);
+	}
+
+	return self;
+}
+
+static void reactor_source_free(ReactorSource *source)
+{
+	if (source->owns_fd && source->fd >= 0)
+	{
+		close(source->fd);
+	}
+	free(source->filename);
+	free(source);
+}
+
+void reactor_free(Reactor *self)
+{
+	if (!self)
+		return;
+
+	ReactorSource *source = self->sources;
+	while (source)
+	{
+		ReactorSource *next = source->next;
+		reactor_source_free(source);
+		source = next;
+	}
+
+	close(self->epoll_fd);
+	free(self);
+}
+
+static ReactorSource *reactor_register(Reactor *self, int type, int fd,
+									   int owns_fd, uint32_t events,
+									   void *data)
+{
+	ReactorSource *source = malloc(sizeof(ReactorSource));
+	bzero(source, sizeof(ReactorSource));
+
+	source->type = type;
+	source->fd = fd;
+	source->owns_fd = owns_fd;
+	source->data = data;
+
+	struct epoll_event ev;
+	bzero(&ev, sizeof(ev));
+	ev.events = events;
+	ev.data.ptr = source;
+
+	if (epoll_ctl(self->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+	{
+		perror("In epoll_ctl()");
+		reactor_source_free(source);
+		return NULL;
+	}
+
+	source->next = self->sources;
+	self->sources = source;
+
+	return source;
+}
+
+/*
+ * Watch a descriptor owned by the caller.
+ */
+ReactorSource *reactor_add_fd(Reactor *self, int fd, uint32_t events,
+							  ReactorFdCallback callback, void *data)
+{
+	ReactorSource *source = reactor_register(self, REACTOR_SOURCE_FD, fd, 0,
+											 events, data);
+	if (source)
+		source->fd_callback = callback;
+
+	return source;
+}
+
+/*
+ * Receive the given signals through a signalfd. The signals are blocked, so
+ * nothing runs in signal handler context: the callback is called from the
+ * loop like any other event.
+ */
+ReactorSource *reactor_add_signals(Reactor *self, const int *signals,
+								   int count, ReactorSignalCallback callback,
+								   void *data)
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+
+	for (int i = 0; i < count; ++i)
+	{
+		sigaddset(&mask, signals[i]);
+	}
+
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+
+	int fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0)
+	{
+		perror("In signalfd()");
+		return NULL;
+	}
+
+	ReactorSource *source = reactor_register(self, REACTOR_SOURCE_SIGNAL, fd, 1,
+											 EPOLLIN, data);
+	if (source)
+		source->signal_callback = callback;
+
+	return source;
+}
+
+/*
+ * Be told when a file is written or replaced. The directory is watched, as
+ * most editors save by writing a new file and renaming it over the old one.
+ */
+ReactorSource *reactor_watch_file(Reactor *self, const char *filename,
+								  ReactorFileCallback callback, void *data)
+{
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0)
+	{
+		perror("In inotify_init1()");
+		return NULL;
+	}
+
+	char *dir_copy = strdup(filename);
+	char *dir = dirname(dir_copy);
+
+	if (inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+	{
+		perror("In inotify_add_watch()");
+		free(dir_copy);
+		close(fd);
+		return NULL;
+	}
+	free(dir_copy);
+
+	ReactorSource *source = reactor_register(self, REACTOR_SOURCE_FILE, fd, 1,
+											 EPOLLIN, data);
+	if (source)
+	{
+		source->file_callback = callback;
+		source->filename = strdup(filename);
+		source->basename = basename(source->filename);
+	}
+
+	return source;
+}
+
+ReactorTimer *reactor_add_timer(Reactor *self, ReactorTimerCallback callback,
+								void *data)
+{
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (fd < 0)
+	{
+		perror("In timerfd_create()");
+		return NULL;
+	}
+
+	ReactorSource *source = reactor_register(self, REACTOR_SOURCE_TIMER, fd, 1,
+											 EPOLLIN, data);
+	if (source)
+		source->timer_callback = callback;
+
+	return source;
+}
+
+static void ms_to_timespec(int ms, struct timespec *ts)
+{
+	ts->tv_sec = ms / 1000;
+	ts->tv_nsec = (long)(ms % 1000) * 1000000L;
+}
+
+/*
+ * Fire once after delay_ms and then every interval_ms (0 for a one-shot).
+ */
+void reactor_timer_start(ReactorTimer *timer, int delay_ms, int interval_ms)
+{
+	assert(timer);
+
+	struct itimerspec spec;
+	bzero(&spec, sizeof(spec));
+
+	/* a zero it_value would disarm the timer */
+	ms_to_timespec(delay_ms > 0 ? delay_ms : 0, &spec.it_value);
+	if (delay_ms <= 0)
+		spec.it_value.tv_nsec = 1;
+	ms_to_timespec(interval_ms, &spec.it_interval);
+
+	timerfd_settime(timer->fd, 0, &spec, NULL);
+}
+
+void reactor_timer_stop(ReactorTimer *timer)
+{
+	assert(timer);
+
+	struct itimerspec spec;
+	bzero(&spec, sizeof(spec));
+
+	timerfd_settime(timer->fd, 0, &spec, NULL);
+}
+
+void reactor_remove(Reactor *self, ReactorSource *source)
+{
+	if (!source || source->removed)
+		return;
+
+	epoll_ctl(self->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+	source->removed = 1;
+	self->has_removed = 1;
+}
+
+static void reactor_sweep(Reactor *self)
+{
+	ReactorSource **link = &self->sources;
+
+	while (*link)
+	{
+		ReactorSource *source = *link;
+		if (source->removed)
+		{
+			*link = source->next;
+			reactor_source_free(source);
+		}
+		else
+		{
+			link = &source->next;
+		}
+	}
+
+	self->has_removed = 0;
+}
+
+static void reactor_dispatch_file(ReactorSource *source)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+	int changed = 0;
+
+	while ((len = read(source->fd, buf, sizeof(buf))) > 0)
+	{
+		char *ptr = buf;
+		while (ptr < buf + len)
+		{
+			struct inotify_event *event = (struct inotify_event *)ptr;
+			if (event->len && strcmp(event->name, source->basename) == 0)
+			{
+				changed = 1;
+			}
+			ptr += sizeof(struct inotify_event) + event->len;
+		}
+	}
+
+	/* one notification for a burst of writes */
+	if (changed)
+	{
+		source->file_callback(source->data, source->filename);
+	}
+}
+
+static void reactor_dispatch(ReactorSource *source, uint32_t events)
+{
+	switch (source->type)
+	{
+	case REACTOR_SOURCE_FD:
+		source->fd_callback(source->data, source->fd, events);
+		break;
+
+	case REACTOR_SOURCE_TIMER:
+	{
+		uint64_t expirations;
+		if (read(source->fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+		{
+			source->timer_callback(source->data);
+		}
+		break;
+	}
+
+	case REACTOR_SOURCE_SIGNAL:
+	{
+		struct signalfd_siginfo info;
+		while (read(source->fd, &info, sizeof(info)) == sizeof(info))
+		{
+			source->signal_callback(source->data, &info);
+			if (source->removed)
+				break;
+		}
+		break;
+	}
+
+	case REACTOR_SOURCE_FILE:
+		reactor_dispatch_file(source);
+		break;
+	}
+}
+
+void reactor_set_prepare(Reactor *self, ReactorPrepareCallback callback,
+						 void *data)
+{
+	self->prepare_callback = callback;
+	self->prepare_data = data;
+}
+
+/*
+ * Run until reactor_stop is called.
+ */
+void reactor_run(Reactor *self)
+{
+	struct epoll_event events[REACTOR_MAX_EVENTS];
+
+	self->running = 1;
+
+	while (self->running)
+	{
+		if (self->prepare_callback)
+		{
+			self->prepare_callback(self->prepare_data);
+			if (!self->running)
+				break;
+		}
+
+		int n = epoll_wait(self->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			perror("In epoll_wait()");
+			break;
+		}
+
+		for (int i = 0; i < n; ++i)
+		{
+			ReactorSource *source = events[i].data.ptr;
+			if (!source->removed)
+			{
+				reactor_dispatch(source, events[i].events);
+			}
+		}
+
+		if (self->has_removed)
+		{
+			reactor_sweep(self);
+		}
+	}
+}
+
+void reactor_stop(Reactor *self)
+{
+	self->running = 0;
+}
@@ -0,0 +1,106 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#ifndef MYGESTURES_REACTOR_H_
+#define MYGESTURES_REACTOR_H_
+
+#include <stdint.h>
+#include <sys/signalfd.h>
+
+/*
+ * A single threaded event loop over epoll. Everything the grabber waits for
+ * (the X connection, signals, timers, file changes and the control socket)
+ * is a file descriptor watched here, so there is no blocking call other
+ * than epoll_wait.
+ */
+
+typedef void (*ReactorFdCallback)(void *data, int fd, uint32_t events);
+typedef void (*ReactorTimerCallback)(void *data);
+typedef void (*ReactorSignalCallback)(void *data, struct signalfd_siginfo *info);
+typedef void (*ReactorFileCallback)(void *data, const char *filename);
+typedef void (*ReactorPrepareCallback)(void *data);
+
+enum
+{
+	REACTOR_SOURCE_FD,
+	REACTOR_SOURCE_TIMER,
+	REACTOR_SOURCE_SIGNAL,
+	REACTOR_SOURCE_FILE
+};
+
+typedef struct reactor_source_
+{
+	int type;
+	int fd;
+	int owns_fd;
+	int removed;
+
+	void *data;
+	ReactorFdCallback fd_callback;
+	ReactorTimerCallback timer_callback;
+	ReactorSignalCallback signal_callback;
+	ReactorFileCallback file_callback;
+
+	/* REACTOR_SOURCE_FILE: the watched path and its name in the directory */
+	char *filename;
+	char *basename;
+
+	struct reactor_source_ *next;
+
+} ReactorSource;
+
+typedef ReactorSource ReactorTimer;
+
+typedef struct reactor_
+{
+	int epoll_fd;
+	int running;
+
+	/* called before waiting, e.g. to flush or drain buffered input */
+	ReactorPrepareCallback prepare_callback;
+	void *prepare_data;
+
+	ReactorSource *sources;
+
+	/* sources removed while dispatching are freed after the batch */
+	int has_removed;
+
+} Reactor;
+
+Reactor *reactor_new();
+void reactor_free(Reactor *self);
+
+void reactor_run(Reactor *self);
+void reactor_stop(Reactor *self);
+
+void reactor_set_prepare(Reactor *self, ReactorPrepareCallback callback,
+						 void *data);
+
+ReactorSource *reactor_add_fd(Reactor *self, int fd, uint32_t events,
+							  ReactorFdCallback callback, void *data);
+ReactorSource *reactor_add_signals(Reactor *self, const int *signals,
+								   int count, ReactorSignalCallback callback,
+								   void *data);
+ReactorSource *reactor_watch_file(Reactor *self, const char *filename,
+								  ReactorFileCallback callback, void *data);
+void reactor_remove(Reactor *self, ReactorSource *source);
+
+ReactorTimer *reactor_add_timer(Reactor *self, ReactorTimerCallback callback,
+								void *data);
+void reactor_timer_start(ReactorTimer *timer, int delay_ms, int interval_ms);
+void reactor_timer_stop(ReactorTimer *timer);
+
+#endif /* MYGESTURES_REACTOR_H_ */
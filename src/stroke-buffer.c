@@ -0,0 +1,158 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <strings.h>
+
+#include "stroke-buffer.h"
+
+StrokeBuffer *stroke_buffer_new(int capacity)
+{
+	StrokeBuffer *self = malloc(sizeof(StrokeBuffer));
+	bzero(self, sizeof(StrokeBuffer));
+
+	self->capacity = capacity;
+	self->strokes = malloc(sizeof(Stroke) * capacity);
+	self->sequence = malloc(capacity + 1);
+	self->sequence[0] = '\0';
+
+	return self;
+}
+
+void stroke_buffer_free(StrokeBuffer *self)
+{
+	if (!self)
+		return;
+
+	free(self->strokes);
+	free(self->sequence);
+	free(self);
+}
+
+void stroke_buffer_clear(StrokeBuffer *self)
+{
+	self->count = 0;
+	self->truncated = 0;
+	self->sequence[0] = '\0';
+	self->candidate.direction = '\0';
+}
+
+Stroke *stroke_buffer_last(StrokeBuffer *self)
+{
+	if (self->count == 0)
+		return NULL;
+
+	return &self->strokes[self->count - 1];
+}
+
+/*
+ * Extend the last stroke if it has the same direction, otherwise start a
+ * new one.
+ */
+void stroke_buffer_add(StrokeBuffer *self, char direction, double length,
+					   Time start_time, Time end_time)
+{
+	if (self->truncated)
+	{
+		return;
+	}
+
+	Stroke *last = stroke_buffer_last(self);
+
+	if (last && last->direction == direction)
+	{
+		last->length += length;
+		last->end_time = end_time;
+		return;
+	}
+
+	if (self->count == self->capacity)
+	{
+		self->truncated = 1;
+		return;
+	}
+
+	Stroke *stroke = &self->strokes[self->count];
+	stroke->direction = direction;
+	stroke->length = length;
+	stroke->start_time = start_time;
+	stroke->end_time = end_time;
+
+	self->sequence[self->count] = direction;
+	self->count++;
+	self->sequence[self->count] = '\0';
+}
+
+/*
+ * Like stroke_buffer_add, but a change of direction only becomes a stroke
+ * once at least min_length was drawn in the new direction. Shorter
+ * detours, like hand jitter, are dropped.
+ */
+void stroke_buffer_add_filtered(StrokeBuffer *self, char direction,
+								double length, Time start_time,
+								Time end_time, double min_length)
+{
+	Stroke *last = stroke_buffer_last(self);
+	Stroke *candidate = &self->candidate;
+
+	if (!last || last->direction == direction)
+	{
+		candidate->direction = '\0';
+		stroke_buffer_add(self, direction, length, start_time, end_time);
+		return;
+	}
+
+	if (candidate->direction != direction)
+	{
+		candidate->direction = direction;
+		candidate->length = 0;
+		candidate->start_time = start_time;
+	}
+
+	candidate->length += length;
+	candidate->end_time = end_time;
+
+	if (candidate->length >= min_length)
+	{
+		candidate->direction = '\0';
+		stroke_buffer_add(self, direction, candidate->length,
+						  candidate->start_time, end_time);
+	}
+}
+
+/*
+ * At the end of a gesture, keep a pending change of direction that is at
+ * least min_length long, even if it never got long enough to be committed.
+ */
+void stroke_buffer_flush_candidate(StrokeBuffer *self, double min_length)
+{
+	Stroke *candidate = &self->candidate;
+
+	if (candidate->direction && candidate->length >= min_length)
+	{
+		stroke_buffer_add(self, candidate->direction, candidate->length,
+						  candidate->start_time, candidate->end_time);
+	}
+
+	candidate->direction = '\0';
+}
+
+unsigned int stroke_get_duration(Stroke *stroke)
+{
+	/* event times are 32 bit milliseconds and may wrap */
+	return (uint32_t)(stroke->end_time - stroke->start_time);
+}
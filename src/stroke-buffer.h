@@ -0,0 +1,72 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#ifndef MYGESTURES_STROKE_BUFFER_H_
+#define MYGESTURES_STROKE_BUFFER_H_
+
+#include <X11/Xlib.h>
+
+/*
+ * A run of samples in the same direction. Equal consecutive directions are
+ * merged, so each stroke also knows how long it is and how long it took.
+ */
+typedef struct stroke_
+{
+	char direction;
+	double length;
+	Time start_time;
+	Time end_time;
+
+} Stroke;
+
+/*
+ * The strokes of a gesture, with their directions also kept as a string
+ * for the movement expressions. Appending is O(1); strokes past the
+ * capacity are dropped and the buffer is marked as truncated.
+ */
+typedef struct stroke_buffer_
+{
+	Stroke *strokes;
+	int count;
+	int capacity;
+	int truncated;
+
+	/* directions of the strokes, count characters long */
+	char *sequence;
+
+	/* a new direction that is not long enough yet to become a stroke */
+	Stroke candidate;
+
+} StrokeBuffer;
+
+StrokeBuffer *stroke_buffer_new(int capacity);
+void stroke_buffer_free(StrokeBuffer *self);
+
+void stroke_buffer_clear(StrokeBuffer *self);
+void stroke_buffer_add(StrokeBuffer *self, char direction, double length,
+					   Time start_time, Time end_time);
+
+void stroke_buffer_add_filtered(StrokeBuffer *self, char direction,
+								double length, Time start_time,
+								Time end_time, double min_length);
+void stroke_buffer_flush_candidate(StrokeBuffer *self, double min_length);
+
+Stroke *stroke_buffer_last(StrokeBuffer *self);
+
+/* milliseconds between the first and last sample of the stroke */
+unsigned int stroke_get_duration(Stroke *stroke);
+
+#endif /* MYGESTURES_STROKE_BUFFER_H_ */
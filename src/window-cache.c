@@ -0,0 +1,735 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib-xcb.h>
+
+#include "atoms.h"
+#include "window-cache.h"
+
+#define WINDOW_CACHE_INITIAL_CAPACITY 64
+
+/* in 32 bit units, as used by GetProperty */
+#define WINDOW_PROPERTY_MAX_LENGTH 1024
+
+WindowCache *window_cache_new(Display *dpy)
+{
+	assert(dpy);
+
+	WindowCache *self = malloc(sizeof(WindowCache));
+	bzero(self, sizeof(WindowCache));
+
+	self->dpy = dpy;
+	self->xcb = XGetXCBConnection(dpy);
+	self->capacity = WINDOW_CACHE_INITIAL_CAPACITY;
+	self->entries = malloc(sizeof(WindowCacheEntry *) * self->capacity);
+
+	return self;
+}
+
+static void window_cache_entry_clear_info(WindowCache *self,
+										  WindowCacheEntry *entry)
+{
+	if (entry->info_valid)
+		self->generation++;
+
+	free(entry->info.title);
+	free(entry->info.class);
+	entry->info.title = NULL;
+	entry->info.class = NULL;
+	entry->info_valid = 0;
+}
+
+static void window_cache_entry_free(WindowCache *self,
+									WindowCacheEntry *entry)
+{
+	window_cache_entry_clear_info(self, entry);
+	free(entry);
+}
+
+void window_cache_free(WindowCache *self)
+{
+	if (!self)
+		return;
+
+	for (int i = 0; i < self->count; ++i)
+	{
+		window_cache_entry_free(self, self->entries[i]);
+	}
+
+	free(self->entries);
+	free(self);
+}
+
+/*
+ * Ask every root window to report when its children are destroyed or
+ * reparented, so stale frame->client entries can be dropped.
+ */
+void window_cache_select_events(WindowCache *self)
+{
+	int count = XScreenCount(self->dpy);
+
+	for (int screen = 0; screen < count; screen++)
+	{
+		XSelectInput(self->dpy, RootWindow(self->dpy, screen),
+					 SubstructureNotifyMask);
+	}
+}
+
+static int window_cache_is_root(WindowCache *self, Window w)
+{
+	int count = XScreenCount(self->dpy);
+
+	for (int screen = 0; screen < count; screen++)
+	{
+		if (RootWindow(self->dpy, screen) == w)
+			return 1;
+	}
+	return 0;
+}
+
+/*
+ * Be told when a window goes away or changes its name or class.
+ */
+static void window_cache_watch(WindowCache *self, Window w)
+{
+	long mask = PropertyChangeMask | StructureNotifyMask;
+
+	/* don't drop the selection made by window_cache_select_events */
+	if (window_cache_is_root(self, w))
+		mask |= SubstructureNotifyMask;
+
+	XSelectInput(self->dpy, w, mask);
+}
+
+static WindowCacheEntry *window_cache_find_by_frame(WindowCache *self,
+													 Window frame)
+{
+	for (int i = 0; i < self->count; ++i)
+	{
+		if (self->entries[i]->frame == frame)
+		{
+			return self->entries[i];
+		}
+	}
+	return NULL;
+}
+
+static WindowCacheEntry *window_cache_find_by_client(WindowCache *self,
+													  Window client)
+{
+	for (int i = 0; i < self->count; ++i)
+	{
+		if (self->entries[i]->client == client)
+		{
+			return self->entries[i];
+		}
+	}
+	return NULL;
+}
+
+static void window_cache_forget(WindowCache *self, Window w)
+{
+	int i = 0;
+	while (i < self->count)
+	{
+		WindowCacheEntry *entry = self->entries[i];
+		if (entry->frame == w || entry->client == w)
+		{
+			window_cache_entry_free(self, entry);
+			self->entries[i] = self->entries[--self->count];
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+static void window_cache_invalidate_info(WindowCache *self, Window w)
+{
+	for (int i = 0; i < self->count; ++i)
+	{
+		WindowCacheEntry *entry = self->entries[i];
+		if (entry->client == w || entry->info_source == w)
+		{
+			window_cache_entry_clear_info(self, entry);
+		}
+	}
+}
+
+static WindowCacheEntry *window_cache_store(WindowCache *self, Window frame,
+											Window client)
+{
+	if (self->count == self->capacity)
+	{
+		self->capacity *= 2;
+		self->entries = realloc(self->entries,
+								sizeof(WindowCacheEntry *) * self->capacity);
+	}
+
+	WindowCacheEntry *entry = malloc(sizeof(WindowCacheEntry));
+	bzero(entry, sizeof(WindowCacheEntry));
+
+	entry->frame = frame;
+	entry->client = client;
+
+	self->entries[self->count++] = entry;
+
+	return entry;
+}
+
+static void window_query_send(WindowCache *self, WindowQuery *q, xcb_window_t w)
+{
+	xcb_connection_t *c = self->xcb;
+
+	bzero(q, sizeof(WindowQuery));
+	q->window = w;
+
+	q->wm_state_cookie = xcb_get_property(c, 0, w, atoms[ATOM_WM_STATE],
+										  XCB_GET_PROPERTY_TYPE_ANY, 0, 0);
+	q->net_wm_name_cookie = xcb_get_property(c, 0, w, atoms[ATOM_NET_WM_NAME],
+											 XCB_GET_PROPERTY_TYPE_ANY, 0,
+											 WINDOW_PROPERTY_MAX_LENGTH);
+	q->wm_name_cookie = xcb_get_property(c, 0, w, XCB_ATOM_WM_NAME,
+										 XCB_GET_PROPERTY_TYPE_ANY, 0,
+										 WINDOW_PROPERTY_MAX_LENGTH);
+	q->wm_class_cookie = xcb_get_property(c, 0, w, XCB_ATOM_WM_CLASS,
+										  XCB_ATOM_STRING, 0,
+										  WINDOW_PROPERTY_MAX_LENGTH);
+}
+
+/*
+ * Returns NULL if the property (or the window) does not exist.
+ */
+static xcb_get_property_reply_t *window_query_reply(WindowCache *self,
+													xcb_get_property_cookie_t cookie)
+{
+	xcb_generic_error_t *error = NULL;
+	xcb_get_property_reply_t *reply = xcb_get_property_reply(self->xcb, cookie,
+															 &error);
+	/* windows may be destroyed at any time, that is not an error for us */
+	free(error);
+
+	if (reply && reply->type == XCB_NONE)
+	{
+		free(reply);
+		reply = NULL;
+	}
+
+	return reply;
+}
+
+static char *text_property_to_string(Display *dpy, XTextProperty *text_prop)
+{
+	char **list = NULL;
+	int num = 0;
+	char *str = NULL;
+
+	if (Xutf8TextPropertyToTextList(dpy, text_prop, &list, &num) >= Success && num > 0 && list && *list)
+	{
+		str = strdup(*list);
+	}
+	if (list)
+		XFreeStringList(list);
+
+	return str;
+}
+
+static char *property_reply_to_string(WindowCache *self,
+									  xcb_get_property_reply_t *reply)
+{
+	if (!reply || reply->format != 8 || !xcb_get_property_value_length(reply))
+	{
+		return NULL;
+	}
+
+	/* converting to UTF-8 is done locally by Xlib, no round trip */
+	XTextProperty text_prop;
+	text_prop.value = xcb_get_property_value(reply);
+	text_prop.encoding = reply->type;
+	text_prop.format = 8;
+	text_prop.nitems = xcb_get_property_value_length(reply);
+
+	return text_property_to_string(self->dpy, &text_prop);
+}
+
+static char *property_reply_to_class(xcb_get_property_reply_t *reply)
+{
+	if (!reply || reply->format != 8)
+	{
+		return NULL;
+	}
+
+	/* WM_CLASS holds "instance\0class\0" */
+	int len = xcb_get_property_value_length(reply);
+	char *value = xcb_get_property_value(reply);
+	int instance_len = strnlen(value, len);
+
+	if (instance_len + 1 >= len)
+	{
+		return NULL;
+	}
+
+	return strndup(value + instance_len + 1, len - instance_len - 1);
+}
+
+static void window_query_collect(WindowCache *self, WindowQuery *q)
+{
+	xcb_get_property_reply_t *reply;
+
+	reply = window_query_reply(self, q->wm_state_cookie);
+	q->has_wm_state = (reply != NULL);
+	free(reply);
+
+	/* Try _NET_WM_NAME (UTF8) first */
+	reply = window_query_reply(self, q->net_wm_name_cookie);
+	q->has_net_wm_name = (reply != NULL);
+	q->title = property_reply_to_string(self, reply);
+	free(reply);
+
+	/* Fallback to WM_NAME */
+	reply = window_query_reply(self, q->wm_name_cookie);
+	if (!q->title)
+		q->title = property_reply_to_string(self, reply);
+	free(reply);
+
+	reply = window_query_reply(self, q->wm_class_cookie);
+	q->class = property_reply_to_class(reply);
+	free(reply);
+}
+
+static void window_query_release(WindowQuery *q)
+{
+	free(q->title);
+	free(q->class);
+	q->title = NULL;
+	q->class = NULL;
+}
+
+static xcb_query_tree_reply_t *window_cache_tree_reply(WindowCache *self,
+													   xcb_query_tree_cookie_t cookie)
+{
+	xcb_generic_error_t *error = NULL;
+	xcb_query_tree_reply_t *reply = xcb_query_tree_reply(self->xcb, cookie,
+														 &error);
+	free(error);
+	return reply;
+}
+
+/*
+ * Query all children of a window at once. Returns NULL if there are none.
+ */
+static WindowQuery *window_cache_query_children(WindowCache *self,
+												xcb_query_tree_reply_t *tree,
+												int *count)
+{
+	*count = 0;
+
+	if (!tree || !xcb_query_tree_children_length(tree))
+	{
+		return NULL;
+	}
+
+	int n = xcb_query_tree_children_length(tree);
+	xcb_window_t *children = xcb_query_tree_children(tree);
+	WindowQuery *queries = malloc(sizeof(WindowQuery) * n);
+
+	for (int i = 0; i < n; ++i)
+	{
+		window_query_send(self, &queries[i], children[i]);
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		window_query_collect(self, &queries[i]);
+	}
+
+	*count = n;
+	return queries;
+}
+
+static void window_cache_release_children(WindowQuery *queries, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		window_query_release(&queries[i]);
+	}
+	free(queries);
+}
+
+static int is_empty(char *str)
+{
+	return !str || str[0] == '\0';
+}
+
+static int window_query_is_complete(WindowQuery *q)
+{
+	return !is_empty(q->title) && !is_empty(q->class);
+}
+
+/*
+ * Move title and class of a client into the cache entry. If they are empty,
+ * take them from the children (common when window is reparented).
+ */
+static void window_cache_entry_take_info(WindowCache *self,
+										 WindowCacheEntry *entry,
+										 WindowQuery *client,
+										 WindowQuery *children, int nchildren)
+{
+	char *win_title = client->title;
+	char *win_class = client->class;
+	client->title = NULL;
+	client->class = NULL;
+
+	entry->info_source = client->window;
+
+	for (int i = 0; i < nchildren; ++i)
+	{
+		WindowQuery *child = &children[i];
+		int used = 0;
+
+		if (is_empty(win_title) && !is_empty(child->title))
+		{
+			free(win_title);
+			win_title = child->title;
+			child->title = NULL;
+			used = 1;
+		}
+
+		if (is_empty(win_class) && !is_empty(child->class))
+		{
+			free(win_class);
+			win_class = child->class;
+			child->class = NULL;
+			used = 1;
+		}
+
+		if (used)
+		{
+			entry->info_source = child->window;
+			XSelectInput(self->dpy, child->window, PropertyChangeMask);
+		}
+
+		if (!is_empty(win_title) && !is_empty(win_class))
+			break;
+	}
+
+	/* Normalize to non-NULL strings */
+	free(entry->info.title);
+	free(entry->info.class);
+	entry->info.title = win_title ? win_title : strdup("");
+	entry->info.class = win_class ? win_class : strdup("");
+	entry->info_valid = 1;
+}
+
+static WindowCacheEntry *window_cache_get_entry(WindowCache *self,
+												 Window client)
+{
+	WindowCacheEntry *entry = window_cache_find_by_client(self, client);
+
+	if (!entry)
+	{
+		/* not reached through a frame, e.g. the root window */
+		entry = window_cache_store(self, None, client);
+		window_cache_watch(self, client);
+	}
+
+	return entry;
+}
+
+/*
+ * Send the requests for the window and its children list. Replies are read
+ * by window_cache_finish_lookup.
+ */
+static void window_cache_send_lookup(WindowCache *self, int type, Window w)
+{
+	WindowCacheLookup *lookup = &self->lookup;
+
+	if (lookup->type != WINDOW_LOOKUP_NONE)
+	{
+		window_cache_finish_lookup(self);
+	}
+
+	lookup->type = type;
+	lookup->window = w;
+	lookup->cancelled = 0;
+
+	window_query_send(self, &lookup->query, w);
+	lookup->tree_cookie = xcb_query_tree(self->xcb, w);
+}
+
+/*
+ * Read title and class of a known client: one round trip for the client
+ * itself and its children list, another one for the children if needed.
+ */
+static Window window_cache_finish_info(WindowCache *self,
+									   WindowQuery *client_query,
+									   xcb_query_tree_reply_t *tree,
+									   int cancelled)
+{
+	WindowQuery *children = NULL;
+	int nchildren = 0;
+
+	if (cancelled)
+	{
+		return client_query->window;
+	}
+
+	if (!window_query_is_complete(client_query))
+	{
+		children = window_cache_query_children(self, tree, &nchildren);
+	}
+
+	WindowCacheEntry *entry = window_cache_get_entry(self, client_query->window);
+	window_cache_entry_take_info(self, entry, client_query, children,
+								 nchildren);
+
+	window_cache_release_children(children, nchildren);
+
+	return entry->client;
+}
+
+/*
+ * Find the client window inside a top-level window and read its title and
+ * class. This is the slow path, only taken the first time a frame is seen.
+ * The frame and its children are each queried in a single round trip.
+ */
+static Window window_cache_finish_frame(WindowCache *self,
+										WindowQuery *frame_query,
+										xcb_query_tree_reply_t *tree,
+										int cancelled)
+{
+	WindowQuery *children = NULL;
+	int nchildren = 0;
+
+	/*
+	 * Children are needed when the frame is not a client (no WM_STATE) or
+	 * lacks title or class.
+	 */
+	if (!frame_query->has_wm_state || !window_query_is_complete(frame_query))
+	{
+		children = window_cache_query_children(self, tree, &nchildren);
+	}
+
+	WindowQuery *client_query = frame_query;
+
+	if (!frame_query->has_wm_state)
+	{
+		/* find a child with WM_STATE or _NET_WM_NAME */
+		for (int i = 0; i < nchildren; ++i)
+		{
+			if (children[i].has_wm_state || children[i].has_net_wm_name)
+			{
+				client_query = &children[i];
+				break;
+			}
+		}
+	}
+
+	Window client = client_query->window;
+
+	/* don't remember frames that were destroyed while we were asking */
+	if (!cancelled)
+	{
+		WindowCacheEntry *entry = window_cache_store(self, frame_query->window,
+													 client);
+		window_cache_watch(self, client);
+
+		if (client_query == frame_query)
+		{
+			window_cache_entry_take_info(self, entry, client_query, children,
+										 nchildren);
+		}
+		else if (window_query_is_complete(client_query))
+		{
+			window_cache_entry_take_info(self, entry, client_query, NULL, 0);
+		}
+		/* else: the client's own children will be looked at on first use */
+	}
+
+	window_cache_release_children(children, nchildren);
+
+	return client;
+}
+
+/*
+ * Start resolving the client window for a pointer event. 'root' and 'child'
+ * are the fields reported by the server for an event on the root window, so
+ * 'child' is the top-level window under the pointer.
+ *
+ * Returns the client if it and its title and class are already known, which
+ * costs no round trips. Otherwise the needed requests are sent, None is
+ * returned and window_cache_finish_lookup reads the replies later.
+ */
+Window window_cache_start_lookup(WindowCache *self, Window root, Window child)
+{
+	assert(self);
+
+	/* drop a previous lookup nobody finished */
+	if (self->lookup.type != WINDOW_LOOKUP_NONE)
+	{
+		window_cache_finish_lookup(self);
+	}
+
+	WindowCacheEntry *entry = NULL;
+
+	if (child == None)
+	{
+		/* pointer is on root */
+		entry = window_cache_get_entry(self, root);
+	}
+	else
+	{
+		entry = window_cache_find_by_frame(self, child);
+	}
+
+	if (!entry)
+	{
+		window_cache_send_lookup(self, WINDOW_LOOKUP_FRAME, child);
+		return None;
+	}
+
+	if (!entry->info_valid)
+	{
+		window_cache_send_lookup(self, WINDOW_LOOKUP_INFO, entry->client);
+		return None;
+	}
+
+	return entry->client;
+}
+
+/*
+ * Read the replies of the lookup started by window_cache_start_lookup and
+ * return the client window.
+ */
+Window window_cache_finish_lookup(WindowCache *self)
+{
+	assert(self);
+
+	WindowCacheLookup *lookup = &self->lookup;
+	Window client = lookup->window;
+
+	if (lookup->type == WINDOW_LOOKUP_NONE)
+	{
+		return None;
+	}
+
+	window_query_collect(self, &lookup->query);
+	xcb_query_tree_reply_t *tree = window_cache_tree_reply(self,
+														   lookup->tree_cookie);
+
+	if (lookup->type == WINDOW_LOOKUP_FRAME)
+	{
+		client = window_cache_finish_frame(self, &lookup->query, tree,
+										   lookup->cancelled);
+	}
+	else
+	{
+		client = window_cache_finish_info(self, &lookup->query, tree,
+										  lookup->cancelled);
+	}
+
+	window_query_release(&lookup->query);
+	free(tree);
+
+	lookup->type = WINDOW_LOOKUP_NONE;
+
+	return client;
+}
+
+/*
+ * Resolve the client window for a pointer event right away.
+ */
+Window window_cache_get_client(WindowCache *self, Window root, Window child)
+{
+	Window client = window_cache_start_lookup(self, root, child);
+
+	if (client == None)
+	{
+		client = window_cache_finish_lookup(self);
+	}
+
+	return client;
+}
+
+/*
+ * Fallback for grabbers that have no XI event at hand.
+ */
+Window window_cache_get_client_under_pointer(WindowCache *self)
+{
+	Window root_return, child_return;
+	int root_x_return, root_y_return;
+	int win_x_return, win_y_return;
+	unsigned int mask_return;
+
+	if (!XQueryPointer(self->dpy, DefaultRootWindow(self->dpy), &root_return,
+					   &child_return, &root_x_return, &root_y_return,
+					   &win_x_return, &win_y_return, &mask_return))
+	{
+		return None;
+	}
+
+	return window_cache_get_client(self, root_return, child_return);
+}
+
+/*
+ * Title and class of a client window. The returned struct belongs to the
+ * cache and stays valid until the next event is handled.
+ */
+ActiveWindowInfo *window_cache_get_info(WindowCache *self, Window client)
+{
+	assert(self);
+
+	WindowCacheEntry *entry = window_cache_get_entry(self, client);
+
+	if (!entry->info_valid)
+	{
+		window_cache_send_lookup(self, WINDOW_LOOKUP_INFO, client);
+		window_cache_finish_lookup(self);
+	}
+
+	return &entry->info;
+}
+
+void window_cache_handle_event(WindowCache *self, XEvent *ev)
+{
+	switch (ev->type)
+	{
+	case DestroyNotify:
+		window_cache_forget(self, ev->xdestroywindow.window);
+		if (self->lookup.window == ev->xdestroywindow.window)
+			self->lookup.cancelled = 1;
+		break;
+	case ReparentNotify:
+		window_cache_forget(self, ev->xreparent.window);
+		window_cache_forget(self, ev->xreparent.parent);
+		break;
+	case PropertyNotify:
+		if (ev->xproperty.atom == atoms[ATOM_NET_WM_NAME] ||
+			ev->xproperty.atom == XA_WM_NAME ||
+			ev->xproperty.atom == XA_WM_CLASS)
+		{
+			window_cache_invalidate_info(self, ev->xproperty.window);
+		}
+		break;
+	}
+}
@@ -0,0 +1,113 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#ifndef MYGESTURES_WINDOW_CACHE_H_
+#define MYGESTURES_WINDOW_CACHE_H_
+
+#include <X11/Xlib.h>
+#include <xcb/xcb.h>
+
+#include "configuration.h"
+
+/*
+ * Everything we know about a client window: the top-level window that
+ * holds it (usually a frame created by the window manager) and its title
+ * and class. The info is fetched the first time it is needed and kept up
+ * to date by PropertyNotify/DestroyNotify events on the windows involved.
+ */
+typedef struct window_cache_entry_
+{
+	Window client;
+	Window frame;
+
+	/* window the title/class were read from (client or one of its children) */
+	Window info_source;
+	int info_valid;
+	ActiveWindowInfo info;
+
+} WindowCacheEntry;
+
+/*
+ * Property requests for one window. All requests of a lookup are sent
+ * before the first reply is read, so each level of the window tree costs
+ * a single round trip instead of one per property and window.
+ */
+typedef struct window_query_
+{
+	xcb_window_t window;
+
+	xcb_get_property_cookie_t wm_state_cookie;
+	xcb_get_property_cookie_t net_wm_name_cookie;
+	xcb_get_property_cookie_t wm_name_cookie;
+	xcb_get_property_cookie_t wm_class_cookie;
+
+	int has_wm_state;
+	int has_net_wm_name;
+	char *title;
+	char *class;
+
+} WindowQuery;
+
+enum
+{
+	WINDOW_LOOKUP_NONE = 0,
+	WINDOW_LOOKUP_FRAME,
+	WINDOW_LOOKUP_INFO
+};
+
+/* A lookup whose requests were sent but whose replies were not read yet */
+typedef struct window_cache_lookup_
+{
+	int type;
+	Window window;
+	int cancelled;
+
+	WindowQuery query;
+	xcb_query_tree_cookie_t tree_cookie;
+
+} WindowCacheLookup;
+
+typedef struct window_cache_
+{
+	Display *dpy;
+	xcb_connection_t *xcb;
+
+	WindowCacheEntry **entries;
+	int count;
+	int capacity;
+
+	WindowCacheLookup lookup;
+
+	/* changes whenever window info previously returned may be outdated */
+	unsigned int generation;
+
+} WindowCache;
+
+WindowCache *window_cache_new(Display *dpy);
+void window_cache_free(WindowCache *self);
+
+void window_cache_select_events(WindowCache *self);
+void window_cache_handle_event(WindowCache *self, XEvent *ev);
+
+Window window_cache_start_lookup(WindowCache *self, Window root, Window child);
+Window window_cache_finish_lookup(WindowCache *self);
+
+Window window_cache_get_client(WindowCache *self, Window root, Window child);
+Window window_cache_get_client_under_pointer(WindowCache *self);
+
+ActiveWindowInfo *window_cache_get_info(WindowCache *self, Window client);
+
+#endif /* MYGESTURES_WINDOW_CACHE_H_ */
@@ -0,0 +1,159 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#include <stdio.h>
+
+#include <X11/Xlibint.h>
+#include <X11/extensions/XI2proto.h>
+#include <X11/extensions/XI2.h>
+
+#include "xi-motion.h"
+
+typedef Bool (*WireToCookieProc)(Display *, XGenericEventCookie *, xEvent *);
+
+_Static_assert(sizeof(XIMotionEvent) <= sizeof(XEvent),
+			   "XIMotionEvent must fit in an XEvent");
+_Static_assert(sizeof(XIRawMotionEvent) <= sizeof(XEvent),
+			   "XIRawMotionEvent must fit in an XEvent");
+
+/* libXi handler, still used for every other XI2 event */
+static WireToCookieProc libxi_wire_to_cookie = NULL;
+
+static double fp1616_to_double(FP1616 value)
+{
+	return value / 65536.0;
+}
+
+static double fp3232_to_double(FP3232 value)
+{
+	return value.integral + value.frac / 4294967296.0;
+}
+
+static void xi_motion_fill_header(Display *dpy, XGenericEventCookie *header,
+								  int type, xGenericEvent *event)
+{
+	/* a type other than GenericEvent keeps Xlib from storing the cookie */
+	header->type = type;
+	header->serial = _XSetLastRequestRead(dpy, (xGenericReply *)event);
+	header->send_event = ((event->type & 0x80) != 0);
+	header->display = dpy;
+	header->extension = event->extension;
+	header->evtype = event->evtype;
+	header->data = NULL;
+}
+
+/*
+ * The wire event is followed by the valuator mask, the accelerated values
+ * and the raw values, one FP3232 per bit set in the mask.
+ */
+static void xi_motion_decode_raw(xXIRawEvent *wire, XIRawMotionEvent *raw)
+{
+	unsigned char *mask = (unsigned char *)&wire[1];
+	int mask_bits = wire->valuators_len * 4 * 8;
+	FP3232 *values = (FP3232 *)(mask + wire->valuators_len * 4);
+
+	int count = 0;
+	int i;
+	for (i = 0; i < mask_bits; i++)
+	{
+		if (XIMaskIsSet(mask, i))
+		{
+			count++;
+		}
+	}
+
+	FP3232 *raw_values = values + count;
+
+	raw->delta_x = 0;
+	raw->delta_y = 0;
+
+	int index = 0;
+	for (i = 0; i < mask_bits && i < 2; i++)
+	{
+		if (XIMaskIsSet(mask, i))
+		{
+			double value = fp3232_to_double(raw_values[index++]);
+
+			if (i == 0)
+				raw->delta_x = value;
+			else
+				raw->delta_y = value;
+		}
+	}
+}
+
+/*
+ * Called by Xlib for each XI2 event read from the connection. The cookie
+ * points to the XEvent in the queue, so a motion event is written there
+ * directly and nothing is allocated.
+ */
+static Bool xi_motion_wire_to_cookie(Display *dpy, XGenericEventCookie *cookie,
+									 xEvent *event)
+{
+	xGenericEvent *generic = (xGenericEvent *)event;
+
+	if (generic->evtype == XI_RawMotion)
+	{
+		xXIRawEvent *wire = (xXIRawEvent *)event;
+		XIRawMotionEvent *raw = (XIRawMotionEvent *)cookie;
+
+		xi_motion_fill_header(dpy, &raw->header, XI_RAW_MOTION_EVENT, generic);
+
+		raw->deviceid = wire->deviceid;
+		raw->sourceid = wire->sourceid;
+		raw->time = wire->time;
+		xi_motion_decode_raw(wire, raw);
+
+		return True;
+	}
+
+	if (generic->evtype != XI_Motion)
+	{
+		return libxi_wire_to_cookie(dpy, cookie, event);
+	}
+
+	xXIDeviceEvent *wire = (xXIDeviceEvent *)event;
+	XIMotionEvent *motion = (XIMotionEvent *)cookie;
+
+	xi_motion_fill_header(dpy, &motion->header, XI_MOTION_EVENT, generic);
+
+	motion->deviceid = wire->deviceid;
+	motion->sourceid = wire->sourceid;
+	motion->time = wire->time;
+	motion->root = wire->root;
+	motion->child = wire->child;
+	motion->root_x = fp1616_to_double(wire->root_x);
+	motion->root_y = fp1616_to_double(wire->root_y);
+
+	return True;
+}
+
+/*
+ * Must be called after libXi registered its own handler, that is, after
+ * the first XI2 request on the display (e.g. XIQueryVersion).
+ */
+void xi_motion_install(Display *dpy, int opcode)
+{
+	libxi_wire_to_cookie = XESetWireToEventCookie(dpy, opcode,
+												  xi_motion_wire_to_cookie);
+
+	if (!libxi_wire_to_cookie)
+	{
+		/* no one to hand the other events to, keep the default path */
+		XESetWireToEventCookie(dpy, opcode, NULL);
+		fprintf(stderr, "XI2 events are not handled by libXi yet.\n");
+	}
+}
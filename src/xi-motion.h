@@ -0,0 +1,69 @@
+/*
+ Copyright 2013-2016 Lucas Augusto Deters
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2, or (at your option)
+ any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ one line to give the program's name and an idea of what it does.
+ */
+
+#ifndef MYGESTURES_XI_MOTION_H_
+#define MYGESTURES_XI_MOTION_H_
+
+#include <X11/Xlib.h>
+
+/*
+ * XI_Motion events decoded straight from the wire into the event queue.
+ *
+ * libXi turns every XI2 event into a cookie whose data is a heap allocated
+ * XIDeviceEvent, with copies of the button, valuator and modifier masks.
+ * Motion events come at the device rate and all we need from them is the
+ * pointer position, so they are decoded in place instead and returned by
+ * XNextEvent with the type XI_MOTION_EVENT. XI_RawMotion events are
+ * reduced to the unaccelerated deltas of the first two valuators and
+ * returned as XI_RAW_MOTION_EVENT.
+ */
+
+/* not used by the core protocol or by any extension */
+#define XI_MOTION_EVENT LASTEvent
+#define XI_RAW_MOTION_EVENT (LASTEvent + 1)
+
+typedef struct
+{
+	/* same layout as the cookie header, Xlib still writes into it */
+	XGenericEventCookie header;
+
+	int deviceid;
+	int sourceid;
+	Time time;
+	Window root;
+	Window child;
+	double root_x;
+	double root_y;
+
+} XIMotionEvent;
+
+typedef struct
+{
+	XGenericEventCookie header;
+
+	int deviceid;
+	int sourceid;
+	Time time;
+
+	/* raw values of valuators 0 and 1, zero when not in the event */
+	double delta_x;
+	double delta_y;
+
+} XIRawMotionEvent;
+
+void xi_motion_install(Display *dpy, int opcode);
+
+#endif /* MYGESTURES_XI_MOTION_H_ */